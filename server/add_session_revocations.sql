@@ -0,0 +1,12 @@
+-- 为已有数据库补建会话吊销表
+-- 注销时服务器写入该表，各服务器进程启动时和运行中定期读取；表不存在时注销会返回DATABASE_ERROR
+-- 表已存在时不做任何修改，可以重复执行
+
+USE puzzle_game;
+
+CREATE TABLE IF NOT EXISTS session_revocations (
+    user_id INT PRIMARY KEY,
+    revoked_before BIGINT NOT NULL,
+    FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
+    INDEX idx_revoked_before (revoked_before)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
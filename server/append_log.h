@@ -0,0 +1,255 @@
+#ifndef APPEND_LOG_H
+#define APPEND_LOG_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+// CRC-32(IEEE 802.3)，用于校验日志和快照中的每条记录
+inline uint32_t crc32(const char* data, size_t size) {
+    static const struct Table {
+        uint32_t values[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                values[i] = c;
+            }
+        }
+    } table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.values[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// 记录编码: 定长整数按本机字节序，字符串为u16长度 + 字节
+class RecordWriter {
+public:
+    explicit RecordWriter(std::string& out) : out(out) {}
+
+    void put8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+    void put32(uint32_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void put64(uint64_t v) { out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void putString(const std::string& s) {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(s.size(), 0xFFFF));
+        out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.append(s.data(), length);
+    }
+
+private:
+    std::string& out;
+};
+
+// 解码一条记录，越界时后续读取全部失败，调用方最后检查ok()
+class RecordReader {
+public:
+    RecordReader(const char* data, size_t size) : data(data), size(size), pos(0), good(true) {}
+
+    uint8_t get8() { uint8_t v = 0; read(&v, sizeof(v)); return v; }
+    uint32_t get32() { uint32_t v = 0; read(&v, sizeof(v)); return v; }
+    uint64_t get64() { uint64_t v = 0; read(&v, sizeof(v)); return v; }
+    std::string getString() {
+        uint16_t length = 0;
+        read(&length, sizeof(length));
+        if (!good || pos + length > size) {
+            good = false;
+            return std::string();
+        }
+        std::string s(data + pos, length);
+        pos += length;
+        return s;
+    }
+
+    bool ok() const { return good && pos == size; }
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+    bool good;
+
+    void read(void* dst, size_t n) {
+        if (!good || pos + n > size) {
+            good = false;
+            return;
+        }
+        memcpy(dst, data + pos, n);
+        pos += n;
+    }
+};
+
+// 只追加的日志文件，每条记录为 [u32 长度][u32 CRC][载荷]
+// - append只把记录放入内存缓冲区，返回记录结束位置(LSN)
+// - waitDurable(lsn)实现组提交: 第一个等待者成为写入者，把缓冲区中所有记录一次write+fdatasync，
+//   期间到达的记录由下一轮一起写出，其他等待者只等条件变量
+// - 写入失败后日志进入失败状态，之后的等待全部返回false
+class AppendLog {
+public:
+    explicit AppendLog(bool sync) : sync(sync), fd(-1), appended(0), durable(0), file_bytes(0),
+                                    flushing(false), write_failed(false), commits(0) {}
+
+    ~AppendLog() {
+        flush();
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    AppendLog(const AppendLog&) = delete;
+    AppendLog& operator=(const AppendLog&) = delete;
+
+    // 打开(或创建)日志文件并追加到末尾，valid_bytes之后的内容(损坏的尾部)被截掉
+    bool open(const std::string& path, uint64_t valid_bytes) {
+        int new_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (new_fd == -1) {
+            return false;
+        }
+        if (ftruncate(new_fd, static_cast<off_t>(valid_bytes)) != 0 ||
+            lseek(new_fd, static_cast<off_t>(valid_bytes), SEEK_SET) < 0) {
+            close(new_fd);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fd != -1) {
+            close(fd);
+        }
+        fd = new_fd;
+        file_bytes = valid_bytes;
+        return true;
+    }
+
+    uint64_t append(const std::string& payload) {
+        uint32_t header[2] = {static_cast<uint32_t>(payload.size()), crc32(payload.data(), payload.size())};
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.append(reinterpret_cast<const char*>(header), sizeof(header));
+        pending += payload;
+        appended += sizeof(header) + payload.size();
+        return appended;
+    }
+
+    bool waitDurable(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (durable < lsn && !write_failed) {
+            if (flushing) {
+                cond.wait(lock);
+                continue;
+            }
+            writePendingLocked(lock);
+        }
+        return !write_failed;
+    }
+
+    // 把已追加的记录全部写入磁盘
+    bool flush() {
+        uint64_t lsn;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            lsn = appended;
+        }
+        return waitDurable(lsn);
+    }
+
+    // 写完当前文件后切换到新文件，用于快照之后开始新一代日志
+    // 调用方保证切换期间没有新的append
+    bool rotate(const std::string& path) {
+        if (!flush()) {
+            return false;
+        }
+        return open(path, 0);
+    }
+
+    uint64_t fileBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return file_bytes;
+    }
+
+    bool failed() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return write_failed;
+    }
+
+    uint64_t commitCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return commits;
+    }
+
+    // 依次校验并回调data中的记录，遇到不完整或校验失败的记录即停止
+    // 返回有效部分的字节数，小于size表示尾部损坏(例如写入中途断电)
+    static size_t replay(const char* data, size_t size, const std::function<bool(const char*, size_t)>& visit) {
+        size_t pos = 0;
+        while (pos + 8 <= size) {
+            uint32_t header[2];
+            memcpy(header, data + pos, sizeof(header));
+            if (header[0] > size - pos - 8 || crc32(data + pos + 8, header[0]) != header[1]) {
+                break;
+            }
+            if (!visit(data + pos + 8, header[0])) {
+                break;
+            }
+            pos += 8 + header[0];
+        }
+        return pos;
+    }
+
+private:
+    bool sync;
+    int fd;
+    uint64_t appended;      // 已追加(含缓冲区中)的字节数
+    uint64_t durable;       // 已写入并同步的字节数
+    uint64_t file_bytes;    // 当前文件的大小
+    std::string pending;
+    bool flushing;
+    bool write_failed;
+    uint64_t commits;       // 组提交次数
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+
+    // 持锁进入，写出期间释放锁让新记录继续进入缓冲区
+    void writePendingLocked(std::unique_lock<std::mutex>& lock) {
+        flushing = true;
+        std::string batch;
+        batch.swap(pending);
+        uint64_t target = appended;
+        int out_fd = fd;
+        lock.unlock();
+
+        bool ok = out_fd != -1;
+        size_t written = 0;
+        while (ok && written < batch.size()) {
+            ssize_t n = ::write(out_fd, batch.data() + written, batch.size() - written);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = n > 0;
+            written += ok ? static_cast<size_t>(n) : 0;
+        }
+        if (ok && sync && !batch.empty()) {
+            ok = fdatasync(out_fd) == 0;
+        }
+
+        lock.lock();
+        flushing = false;
+        if (ok) {
+            durable = target;
+            file_bytes += batch.size();
+            ++commits;
+        }
+        else {
+            write_failed = true;
+        }
+        cond.notify_all();
+    }
+};
+
+#endif // APPEND_LOG_H
@@ -0,0 +1,99 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// JSON库使用nlohmann/json
+#include <nlohmann/json.hpp>
+
+#include "json_writer.h"
+#include "leaderboard.h"
+#include "user_cache.h"
+
+using json = nlohmann::json;
+
+// 一条待写入的游戏成绩
+struct GameResult {
+    RankingType type = RankingType::Level;
+    int user_id = 0;
+    int grid_size = 0;
+    int score = 0;              // max_level / time_seconds / step_count
+    bool used_undo = false;
+    std::time_t time = 0;       // 提交时间，写入update_time / create_time
+};
+
+// 连接池统计信息，没有连接池的存储后端全部为0
+struct DBPoolStats {
+    uint64_t checkouts = 0;       // 成功借出次数
+    uint64_t waits = 0;           // 需要等待空闲连接的次数
+    uint64_t timeouts = 0;        // 等待超时次数
+    uint64_t total_wait_us = 0;   // 累计等待时间(微秒)
+    uint64_t max_wait_us = 0;     // 最长一次等待(微秒)
+    uint64_t connects = 0;        // 新建连接次数(含重连)
+    uint64_t reconnects = 0;      // 因连接失效而重连的次数
+    uint64_t failed_pings = 0;    // mysql_ping失败次数
+    uint64_t prepares = 0;        // 预处理语句prepare次数(每个连接每条语句一次，重连后重新prepare)
+    int open_connections = 0;     // 当前已建立的连接数
+    int idle_connections = 0;     // 当前空闲连接数
+};
+
+// 存储接口: 用户注册登录、排行榜读取和成绩写入
+// 实现: MySQLDatabase(mysql_database.h)、LogDatabase(log_database.h)、MemoryDatabase(memory_database.h)，
+// 由createDatabase按配置选择
+// 所有方法可以被多个工作线程并发调用
+class Database {
+public:
+    virtual ~Database() {}
+
+    // 用户注册，成功时user_id为新用户的id
+    virtual bool registerUser(const std::string& username, const std::string& password,
+                              const std::string& nickname, int& user_id) = 0;
+
+    // 用户登录，并记录最后登录时间(可以延迟到flushPendingWrites时写入)
+    virtual bool loginUser(const std::string& username, const std::string& password,
+                           int& user_id, std::string& nickname) = 0;
+
+    // 排行榜读取，一页数据作为JSON数组直接写入out，返回行数；出错时返回-1(已写出的行保留，数组照常闭合)
+    // after为空时从第一名开始；还有下一页时next_cursor返回游标
+    virtual int writeLevelRankings(JsonFrameWriter& out, int limit = 50, const RankingCursor* after = nullptr,
+                                   std::string* next_cursor = nullptr) = 0;
+    virtual int writeTimeRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                                  const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) = 0;
+    virtual int writeStepRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                                  const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) = 0;
+
+    // 读取整张排行榜，逐行交给sink，用于启动时加载内存排行榜
+    virtual bool loadRankings(RankingType type, const std::function<void(const RankingEntry&)>& sink) = 0;
+
+    // 原子地写入一批成绩，合并规则: 关卡取最大值并刷新update_time；时间/步数取最小值，成绩变好才刷新create_time
+    virtual bool submitGameResults(const std::vector<GameResult>& results) = 0;
+
+    // 写入一条成绩，row_id返回排行榜表中对应行的id
+    virtual bool submitGameResult(int user_id, const std::string& game_type, int grid_size,
+                                  int max_level, int time_seconds, int step_count, bool used_undo,
+                                  int* row_id = nullptr) = 0;
+
+    // 连接池统计(借出等待时间等)
+    virtual DBPoolStats getPoolStats() { return DBPoolStats(); }
+
+    // 由服务器定时调用的维护操作: 空闲连接健康检查、日志压缩等
+    virtual void healthCheck() {}
+    
+    // 登录缓存和延迟写入的最后登录时间统计
+    virtual UserCacheStats getUserCacheStats() { return UserCacheStats(); }
+    
+    // 把延迟写入的数据(最后登录时间)写入存储，由服务器定时调用，停止时再调用一次
+    virtual void flushPendingWrites() {}
+
+    // 会话吊销: 用户注销时记录吊销时间(毫秒)，之前签发的令牌失效；同一用户只保留最晚的一条
+    // 服务器启动时和运行中定期读取revoked_before大于since_ms的记录，使注销在重启后和其他进程中生效
+    // 默认实现不保存，吊销只在本进程内有效
+    virtual bool saveSessionRevocation(int, int64_t) { return true; }
+    virtual bool loadSessionRevocations(int64_t, const std::function<void(int, int64_t)>&) { return true; }
+};
+
+#endif // DATABASE_H
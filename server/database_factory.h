@@ -0,0 +1,28 @@
+#ifndef DATABASE_FACTORY_H
+#define DATABASE_FACTORY_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "database.h"
+#include "log_database.h"
+#include "memory_database.h"
+#include "mysql_database.h"
+#include "server_config.h"
+
+// 按config.storage_backend创建存储后端，名称未知或连接失败时抛出异常
+inline std::unique_ptr<Database> createDatabase(const ServerConfig& config) {
+    if (config.storage_backend == "mysql") {
+        return std::make_unique<MySQLDatabase>(config);
+    }
+    if (config.storage_backend == "log") {
+        return std::make_unique<LogDatabase>(config);
+    }
+    if (config.storage_backend == "memory") {
+        return std::make_unique<MemoryDatabase>(config.storage_seed_users);
+    }
+    throw std::runtime_error("未知的存储后端: " + config.storage_backend);
+}
+
+#endif // DATABASE_FACTORY_H
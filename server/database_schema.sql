@@ -24,7 +24,8 @@ CREATE TABLE IF NOT EXISTS level_rankings (
     FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
     INDEX idx_user_id (user_id),
     INDEX idx_max_level (max_level),
-    INDEX idx_update_time (update_time)
+    INDEX idx_update_time (update_time),
+    INDEX idx_rank_order (max_level DESC, update_time, id)  -- 排行榜keyset分页，MySQL 5.7忽略DESC
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 
 -- 时间排行榜表
@@ -40,6 +41,7 @@ CREATE TABLE IF NOT EXISTS time_rankings (
     INDEX idx_grid_size (grid_size),
     INDEX idx_time_seconds (time_seconds),
     INDEX idx_used_undo (used_undo),
+    INDEX idx_rank_order (grid_size, used_undo, time_seconds, create_time, id),  -- 排行榜keyset分页
     UNIQUE KEY unique_user_grid_undo (user_id, grid_size, used_undo)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 
@@ -56,9 +58,18 @@ CREATE TABLE IF NOT EXISTS step_rankings (
     INDEX idx_grid_size (grid_size),
     INDEX idx_step_count (step_count),
     INDEX idx_used_undo (used_undo),
+    INDEX idx_rank_order (grid_size, used_undo, step_count, create_time, id),  -- 排行榜keyset分页
     UNIQUE KEY unique_user_grid_undo (user_id, grid_size, used_undo)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
 
+-- 会话吊销表：用户注销时记录时间(毫秒)，之前签发的令牌全部失效；各服务器进程定期读取
+CREATE TABLE IF NOT EXISTS session_revocations (
+    user_id INT PRIMARY KEY,
+    revoked_before BIGINT NOT NULL,
+    FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
+    INDEX idx_revoked_before (revoked_before)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;
+
 -- 插入一些测试数据（可选）
 INSERT IGNORE INTO users (username, password, nickname) VALUES 
 ('admin', 'admin123', '管理员'),
@@ -0,0 +1,367 @@
+#ifndef DB_POOL_H
+#define DB_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+
+#include "database.h"
+#include "server_config.h"
+
+// 有上限的MySQL连接池
+// - 连接按需创建，最多db_pool_size个；用完时acquire()在条件变量上等待
+// - 空闲超过db_validate_idle_ms的连接借出前先mysql_ping验证
+// - 查询中出现断线错误的连接会被标记，下次借出时自动重连
+class MySQLConnectionPool {
+private:
+    struct Connection {
+        MYSQL* mysql = nullptr;
+        std::chrono::steady_clock::time_point last_used;
+        bool broken = false;
+        uint64_t generation = 0;  // 每次(重新)建立连接后递增
+        std::vector<MYSQL_STMT*> statements;  // 按语句编号缓存的预处理语句
+    };
+
+public:
+    // 借出的连接，析构时自动归还
+    class Handle {
+    public:
+        Handle() : pool(nullptr), conn(nullptr) {}
+        Handle(MySQLConnectionPool* pool, Connection* conn) : pool(pool), conn(conn) {}
+        Handle(Handle&& other) noexcept : pool(other.pool), conn(other.conn) {
+            other.pool = nullptr;
+            other.conn = nullptr;
+        }
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool = other.pool;
+                conn = other.conn;
+                other.pool = nullptr;
+                other.conn = nullptr;
+            }
+            return *this;
+        }
+        ~Handle() { release(); }
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        explicit operator bool() const { return conn != nullptr; }
+        MYSQL* get() const { return conn ? conn->mysql : nullptr; }
+
+        // 连接建立后的代数，重连后变化，可用于判断该连接上缓存的资源是否仍有效
+        uint64_t generation() const { return conn ? conn->generation : 0; }
+
+        // 取得该连接上已预处理的语句，首次使用(包括重连后)才会prepare
+        // 使用完毕后调用mysql_stmt_free_result，不要关闭语句
+        MYSQL_STMT* statement(size_t id, const std::string& sql) {
+            if (!conn) {
+                return nullptr;
+            }
+            if (id >= conn->statements.size()) {
+                conn->statements.resize(id + 1, nullptr);
+            }
+            if (conn->statements[id]) {
+                return conn->statements[id];
+            }
+
+            MYSQL_STMT* stmt = mysql_stmt_init(conn->mysql);
+            if (!stmt) {
+                return nullptr;
+            }
+            if (mysql_stmt_prepare(stmt, sql.c_str(), sql.length()) != 0) {
+                noteError(mysql_stmt_errno(stmt));
+                mysql_stmt_close(stmt);
+                return nullptr;
+            }
+            conn->statements[id] = stmt;
+            pool->notePrepare();
+            return stmt;
+        }
+
+        // 查询失败时传入错误码，断线类错误会让连接在下次借出时重连
+        void noteError(unsigned int error_code) {
+            if (conn && isConnectionLost(error_code)) {
+                conn->broken = true;
+            }
+        }
+
+    private:
+        MySQLConnectionPool* pool;
+        Connection* conn;
+
+        void release() {
+            if (pool && conn) {
+                pool->giveBack(conn);
+            }
+            pool = nullptr;
+            conn = nullptr;
+        }
+    };
+
+    explicit MySQLConnectionPool(const ServerConfig& cfg)
+        : config(cfg), open_count(0) {
+        static std::once_flag library_once;
+        std::call_once(library_once, []() { mysql_library_init(0, nullptr, nullptr); });
+
+        int pool_size = config.db_pool_size > 0 ? config.db_pool_size : 1;
+        connections.resize(pool_size);
+
+        // 启动时先建立一个连接，配置错误时立即失败
+        std::string error;
+        if (!connect(connections[0], error)) {
+            throw std::runtime_error("数据库连接失败: " + error);
+        }
+        open_count = 1;
+        idle.push_back(&connections[0]);
+        for (int i = pool_size - 1; i >= 1; --i) {
+            unopened.push_back(&connections[i]);
+        }
+    }
+
+    ~MySQLConnectionPool() {
+        for (auto& conn : connections) {
+            closeConnection(conn);
+        }
+    }
+
+    MySQLConnectionPool(const MySQLConnectionPool&) = delete;
+    MySQLConnectionPool& operator=(const MySQLConnectionPool&) = delete;
+
+    // 借出一个可用连接，超时或无法建立连接时返回空Handle
+    Handle acquire() {
+        ensureThreadInit();
+
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::milliseconds(config.db_pool_timeout_ms);
+        Connection* conn = nullptr;
+        bool needs_open = false;
+        bool waited = false;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (idle.empty() && unopened.empty()) {
+                waited = true;
+                if (cond.wait_until(lock, deadline) == std::cv_status::timeout &&
+                    idle.empty() && unopened.empty()) {
+                    ++stats.timeouts;
+                    return Handle();
+                }
+            }
+
+            if (!idle.empty()) {
+                conn = idle.back();
+                idle.pop_back();
+            }
+            else {
+                conn = unopened.back();
+                unopened.pop_back();
+                needs_open = true;
+            }
+
+            uint64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            ++stats.checkouts;
+            if (waited) {
+                ++stats.waits;
+            }
+            stats.total_wait_us += wait_us;
+            if (wait_us > stats.max_wait_us) {
+                stats.max_wait_us = wait_us;
+            }
+        }
+
+        // 建立连接和ping都是网络操作，不持有池锁
+        if (!prepareConnection(conn, needs_open)) {
+            returnUnusable(conn);
+            return Handle();
+        }
+        return Handle(this, conn);
+    }
+
+    // 定期对空闲连接做健康检查，由服务器定时器调用
+    void healthCheck() {
+        std::vector<Connection*> to_check;
+        {
+            // 只取出空闲时间过长的连接，其余连接仍可被正常借出
+            std::lock_guard<std::mutex> lock(mutex);
+            auto stale_before = std::chrono::steady_clock::now() -
+                                std::chrono::milliseconds(config.db_validate_idle_ms);
+            auto it = idle.begin();
+            while (it != idle.end()) {
+                if ((*it)->last_used < stale_before) {
+                    to_check.push_back(*it);
+                    it = idle.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+
+        ensureThreadInit();
+        for (Connection* conn : to_check) {
+            if (!prepareConnection(conn, false)) {
+                returnUnusable(conn);
+            }
+            else {
+                giveBack(conn);
+            }
+        }
+    }
+
+    DBPoolStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        DBPoolStats result = stats;
+        result.open_connections = open_count;
+        result.idle_connections = static_cast<int>(idle.size());
+        return result;
+    }
+
+    int size() const { return static_cast<int>(connections.size()); }
+
+    static bool isConnectionLost(unsigned int error_code) {
+        return error_code == CR_SERVER_GONE_ERROR || error_code == CR_SERVER_LOST;
+    }
+
+private:
+    ServerConfig config;
+    std::vector<Connection> connections;   // 固定大小，元素地址不变
+    std::vector<Connection*> idle;         // 已连接的空闲连接
+    std::vector<Connection*> unopened;     // 尚未建立或已关闭的槽位
+    int open_count;
+    std::mutex mutex;
+    std::condition_variable cond;
+    DBPoolStats stats;
+
+    // libmysqlclient要求每个使用它的线程先调用mysql_thread_init
+    static void ensureThreadInit() {
+        struct ThreadInit {
+            ThreadInit() { mysql_thread_init(); }
+            ~ThreadInit() { mysql_thread_end(); }
+        };
+        static thread_local ThreadInit init;
+        (void)init;
+    }
+
+    bool connect(Connection& conn, std::string& error) {
+        MYSQL* mysql = mysql_init(nullptr);
+        if (!mysql) {
+            error = "MySQL初始化失败";
+            return false;
+        }
+
+        unsigned int timeout = 5;
+        mysql_options(mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+        mysql_options(mysql, MYSQL_OPT_READ_TIMEOUT, &timeout);
+        mysql_options(mysql, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
+
+        if (!mysql_real_connect(mysql, config.db_host.c_str(), config.db_user.c_str(),
+                                config.db_password.c_str(), config.db_name.c_str(),
+                                config.db_port, nullptr, 0)) {
+            error = mysql_error(mysql);
+            mysql_close(mysql);
+            return false;
+        }
+
+        // 设置字符集
+        mysql_set_character_set(mysql, "utf8mb4");
+
+        conn.mysql = mysql;
+        conn.broken = false;
+        conn.last_used = std::chrono::steady_clock::now();
+        ++conn.generation;
+        return true;
+    }
+
+    // 借出前确保连接可用：必要时新建、ping或重连
+    bool prepareConnection(Connection* conn, bool needs_open) {
+        std::string error;
+        if (needs_open) {
+            if (!connect(*conn, error)) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.connects;
+            ++open_count;
+            return true;
+        }
+
+        bool idle_too_long = std::chrono::steady_clock::now() - conn->last_used >
+                             std::chrono::milliseconds(config.db_validate_idle_ms);
+        if (!conn->broken && !idle_too_long) {
+            return true;
+        }
+
+        if (!conn->broken && mysql_ping(conn->mysql) == 0) {
+            conn->last_used = std::chrono::steady_clock::now();
+            return true;
+        }
+
+        if (!conn->broken) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.failed_pings;
+        }
+
+        // 连接已失效，关闭后重连，缓存的语句随之作废
+        closeConnection(*conn);
+        bool ok = connect(*conn, error);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ok) {
+            ++stats.connects;
+            ++stats.reconnects;
+        }
+        else {
+            --open_count;
+        }
+        return ok;
+    }
+
+    static void closeConnection(Connection& conn) {
+        for (MYSQL_STMT*& stmt : conn.statements) {
+            if (stmt) {
+                mysql_stmt_close(stmt);
+                stmt = nullptr;
+            }
+        }
+        if (conn.mysql) {
+            mysql_close(conn.mysql);
+            conn.mysql = nullptr;
+        }
+    }
+
+    void notePrepare() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.prepares;
+    }
+
+    void giveBack(Connection* conn) {
+        conn->last_used = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(conn);
+        }
+        cond.notify_one();
+    }
+
+    // 连接建立失败，槽位回到未连接状态，之后的acquire会再次尝试
+    void returnUnusable(Connection* conn) {
+        closeConnection(*conn);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            unopened.push_back(conn);
+        }
+        cond.notify_one();
+    }
+};
+
+#endif // DB_POOL_H
@@ -0,0 +1,137 @@
+// 数据库连接池基准测试
+// 对本地MySQL/MariaDB并发执行排行榜查询，比较不同连接池大小下的吞吐量。
+//
+// 编译:
+//   g++ -std=c++17 -O2 -o db_pool_bench db_pool_bench.cpp -lmysqlclient -pthread
+// 运行:
+//   ./db_pool_bench --user root --password password --threads 16 --pools 1,2,4,8,16 --seconds 5
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mysql_database.h"
+
+struct BenchOptions {
+    ServerConfig config;
+    int threads = 16;
+    int seconds = 5;
+    int grid_size = 3;
+    int limit = 50;
+    std::vector<int> pool_sizes = {1, 2, 4, 8, 16};
+};
+
+static std::vector<int> parseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(std::stoi(item));
+        }
+    }
+    return values;
+}
+
+static bool parseArgs(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            std::cout << "用法: " << argv[0] << " [--host H] [--port P] [--user U] [--password W] [--database D]\n"
+                      << "       [--threads N] [--seconds S] [--pools 1,2,4,8] [--grid-size G] [--limit L]" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") options.config.db_host = value;
+        else if (arg == "--port") options.config.db_port = std::stoi(value);
+        else if (arg == "--user") options.config.db_user = value;
+        else if (arg == "--password") options.config.db_password = value;
+        else if (arg == "--database") options.config.db_name = value;
+        else if (arg == "--threads") options.threads = std::stoi(value);
+        else if (arg == "--seconds") options.seconds = std::stoi(value);
+        else if (arg == "--pools") options.pool_sizes = parseList(value);
+        else if (arg == "--grid-size") options.grid_size = std::stoi(value);
+        else if (arg == "--limit") options.limit = std::stoi(value);
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        return 1;
+    }
+
+    std::cout << "排行榜查询吞吐量 (线程数: " << options.threads
+              << ", 每轮 " << options.seconds << " 秒)" << std::endl;
+    std::cout << std::left << std::setw(8) << "pool"
+              << std::setw(12) << "qps"
+              << std::setw(10) << "failed"
+              << std::setw(10) << "timeouts"
+              << std::setw(16) << "avg_wait_us"
+              << std::setw(16) << "max_wait_us"
+              << "waits" << std::endl;
+
+    for (int pool_size : options.pool_sizes) {
+        ServerConfig config = options.config;
+        config.db_pool_size = pool_size;
+        config.db_pool_timeout_ms = 10000;
+
+        std::unique_ptr<MySQLDatabase> db;
+        try {
+            db = std::make_unique<MySQLDatabase>(config);
+        }
+        catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> queries(0);
+        std::atomic<uint64_t> failures(0);   // 查询出错或等待连接超时，不计入qps
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < options.threads; ++t) {
+            threads.emplace_back([&, t]() {
+                bool used_undo = (t % 2) == 1;
+                while (!stop) {
+                    JsonFrameWriter out(options.limit * kRankingRowBytes);
+                    if (db->writeStepRankings(out, options.grid_size, used_undo, options.limit) >= 0) {
+                        ++queries;
+                    }
+                    else {
+                        ++failures;
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        DBPoolStats stats = db->getPoolStats();
+        double qps = static_cast<double>(queries) / options.seconds;
+        double avg_wait = stats.checkouts ? static_cast<double>(stats.total_wait_us) / stats.checkouts : 0.0;
+        std::cout << std::left << std::setw(8) << pool_size
+                  << std::setw(12) << std::fixed << std::setprecision(0) << qps
+                  << std::setw(10) << failures
+                  << std::setw(10) << stats.timeouts
+                  << std::setw(16) << std::setprecision(1) << avg_wait
+                  << std::setw(16) << stats.max_wait_us
+                  << stats.waits << std::endl;
+    }
+
+    return 0;
+}
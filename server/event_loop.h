@@ -0,0 +1,212 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+
+// 基于epoll边缘触发(ET)的事件循环
+// - 只在socket可读/可写时唤醒，空闲时阻塞在epoll_wait上
+// - 定时任务由timerfd驱动，不再依赖固定间隔的轮询
+// - stop()和queueInLoop()通过eventfd唤醒，可以从其他线程调用
+class EventLoop {
+public:
+    using EventCallback = std::function<void(uint32_t events)>;
+    using TimerCallback = std::function<void()>;
+    using Task = std::function<void()>;
+
+    // running初始为true: stop()先于run()调用时(例如线程还未启动就收到停止信号)，run()直接返回
+    EventLoop() : running(true) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1) {
+            throw std::runtime_error("epoll_create1失败");
+        }
+
+        wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_fd == -1) {
+            close(epoll_fd);
+            throw std::runtime_error("eventfd创建失败");
+        }
+
+        addFd(wakeup_fd, EPOLLIN | EPOLLET, [this](uint32_t) {
+            drainWakeup();
+            runPendingTasks();
+        });
+    }
+
+    ~EventLoop() {
+        for (int fd : timer_fds) {
+            close(fd);
+        }
+        close(wakeup_fd);
+        close(epoll_fd);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // 注册文件描述符，events通常为 EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET 的组合
+    bool addFd(int fd, uint32_t events, EventCallback callback) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            return false;
+        }
+        handlers[fd] = std::make_shared<EventCallback>(std::move(callback));
+        return true;
+    }
+
+    bool modifyFd(int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    void removeFd(int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        handlers.erase(fd);
+    }
+
+    // 添加周期定时器，返回timerfd，失败返回-1
+    int addTimer(std::chrono::milliseconds interval, TimerCallback callback) {
+        int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tfd == -1) {
+            return -1;
+        }
+
+        itimerspec spec{};
+        spec.it_interval.tv_sec = interval.count() / 1000;
+        spec.it_interval.tv_nsec = (interval.count() % 1000) * 1000000;
+        spec.it_value = spec.it_interval;
+        if (timerfd_settime(tfd, 0, &spec, nullptr) == -1) {
+            close(tfd);
+            return -1;
+        }
+
+        bool added = addFd(tfd, EPOLLIN | EPOLLET, [tfd, callback](uint32_t) {
+            uint64_t expirations;
+            // 读空计数器，多次到期合并为一次回调
+            while (read(tfd, &expirations, sizeof(expirations)) > 0) {}
+            callback();
+        });
+        if (!added) {
+            close(tfd);
+            return -1;
+        }
+
+        timer_fds.push_back(tfd);
+        return tfd;
+    }
+
+    void run() {
+        while (running) {
+            if (poll(-1) < 0) {
+                break;
+            }
+        }
+    }
+
+    // 等待并处理一轮就绪事件，返回处理的事件数，出错返回-1
+    // timeout_ms为0时不阻塞: io_uring后端把epoll fd本身交给io_uring监视，可读时调用poll(0)
+    int poll(int timeout_ms) {
+        epoll_event events[kMaxEvents];
+        int n = epoll_wait(epoll_fd, events, kMaxEvents, timeout_ms);
+        if (n == -1) {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            auto it = handlers.find(events[i].data.fd);
+            if (it == handlers.end()) {
+                // 同一批事件中已被前面的回调移除
+                continue;
+            }
+            // 持有一份引用，回调内部removeFd不会销毁正在执行的函数
+            std::shared_ptr<EventCallback> callback = it->second;
+            (*callback)(events[i].events);
+        }
+        return n;
+    }
+
+    // io_uring后端接管唤醒eventfd: 从epoll中移除并改为阻塞模式，
+    // 调用方通过io_uring读取它，读到后调用runPendingTasks()，省去一次epoll_wait
+    int detachWakeupFd() {
+        removeFd(wakeup_fd);
+        int flags = fcntl(wakeup_fd, F_GETFL, 0);
+        fcntl(wakeup_fd, F_SETFL, flags & ~O_NONBLOCK);
+        return wakeup_fd;
+    }
+
+    void runPendingTasks() {
+        std::vector<Task> tasks;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            tasks.swap(pending_tasks);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+
+    bool isRunning() const { return running; }
+    int fd() const { return epoll_fd; }
+    static constexpr int maxEvents() { return kMaxEvents; }
+
+    void stop() {
+        running = false;
+        wakeup();
+    }
+
+    // 投递任务到事件循环线程执行(完成队列)，线程安全
+    void queueInLoop(Task task) {
+        bool need_wakeup;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex);
+            // 队列非空说明已经唤醒过且还未处理，无需重复写eventfd
+            need_wakeup = pending_tasks.empty();
+            pending_tasks.push_back(std::move(task));
+        }
+        if (need_wakeup) {
+            wakeup();
+        }
+    }
+
+    void wakeup() {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeup_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+private:
+    static constexpr int kMaxEvents = 256;
+
+    int epoll_fd;
+    int wakeup_fd;
+    std::atomic<bool> running;
+    std::unordered_map<int, std::shared_ptr<EventCallback>> handlers;
+    std::vector<int> timer_fds;
+    std::mutex tasks_mutex;
+    std::vector<Task> pending_tasks;
+
+    void drainWakeup() {
+        uint64_t value;
+        while (read(wakeup_fd, &value, sizeof(value)) > 0) {}
+    }
+
+};
+
+#endif // EVENT_LOOP_H
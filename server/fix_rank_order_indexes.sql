@@ -0,0 +1,22 @@
+-- 为已有数据库补充排行榜keyset分页使用的索引
+-- database_schema.sql中的CREATE TABLE IF NOT EXISTS不会修改已存在的表，旧部署需要执行本脚本一次
+-- 索引已存在时ALTER TABLE报Duplicate key name，可以忽略
+-- MySQL 5.7会忽略索引定义中的DESC(按升序建立)：时间和步数排行榜的排序全部为升序，不受影响；
+-- 关卡排行榜按max_level降序、update_time升序排序，方向混合，5.7上翻页仍需要filesort，8.0起可以直接按索引读取
+
+USE puzzle_game;
+
+ALTER TABLE level_rankings
+ADD INDEX idx_rank_order (max_level DESC, update_time, id);
+
+ALTER TABLE time_rankings
+ADD INDEX idx_rank_order (grid_size, used_undo, time_seconds, create_time, id);
+
+ALTER TABLE step_rankings
+ADD INDEX idx_rank_order (grid_size, used_undo, step_count, create_time, id);
+
+-- 验证: 每张表应返回idx_rank_order
+SELECT TABLE_NAME, INDEX_NAME, GROUP_CONCAT(COLUMN_NAME ORDER BY SEQ_IN_INDEX) AS columns
+FROM information_schema.STATISTICS
+WHERE TABLE_SCHEMA = 'puzzle_game' AND INDEX_NAME = 'idx_rank_order'
+GROUP BY TABLE_NAME, INDEX_NAME;
\ No newline at end of file
@@ -0,0 +1,157 @@
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+// 消息缓冲区池
+// 解码出的每一帧都从池中取一个已有容量的std::string，处理完后归还，
+// 避免每条消息都重新分配内存。可以跨线程归还。
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_buffers = 1024, size_t max_capacity = 64 * 1024)
+        : max_buffers(max_buffers), max_capacity(max_capacity) {}
+
+    std::string acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_list.empty()) {
+            return std::string();
+        }
+        std::string buffer = std::move(free_list.back());
+        free_list.pop_back();
+        return buffer;
+    }
+
+    void release(std::string&& buffer) {
+        // 过大的缓冲区直接释放，防止单个大包长期占用内存
+        if (buffer.capacity() > max_capacity) {
+            return;
+        }
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free_list.size() < max_buffers) {
+            free_list.push_back(std::move(buffer));
+        }
+    }
+
+    static BufferPool& instance() {
+        static BufferPool pool;
+        return pool;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::string> free_list;
+    size_t max_buffers;
+    size_t max_capacity;
+};
+
+// 预先编码好的完整帧(4字节大端长度 + 数据)，不可变，可以同时排在多个连接的发送队列中
+using SharedFrame = std::shared_ptr<const std::string>;
+
+inline SharedFrame encodeFrame(const std::string& body) {
+    auto frame = std::make_shared<std::string>();
+    frame->resize(4 + body.size());
+    uint32_t length = htonl(static_cast<uint32_t>(body.size()));
+    memcpy(&(*frame)[0], &length, sizeof(length));
+    memcpy(&(*frame)[4], body.data(), body.size());
+    return frame;
+}
+
+// 增量帧解码器: [4字节大端长度][JSON数据]
+// 状态机在 读长度 -> 读数据 之间切换，半包会保留到下一次可读事件，
+// 一次输入中的多个完整帧都会被解出。
+class FrameDecoder {
+public:
+    static constexpr uint32_t kMaxFrameSize = 1024 * 1024; // 限制最大1MB
+
+    explicit FrameDecoder(BufferPool& pool = BufferPool::instance())
+        : pool(pool), state(State::Header), header_received(0), body_received(0),
+          body_length(0), failed(false) {}
+
+    // 输入新读到的数据，返回false表示协议错误(长度超限)，连接应当关闭
+    bool feed(const char* data, size_t len) {
+        while (len > 0 && !failed) {
+            if (state == State::Header) {
+                size_t n = std::min(len, sizeof(header) - header_received);
+                memcpy(header + header_received, data, n);
+                header_received += n;
+                data += n;
+                len -= n;
+
+                if (header_received == sizeof(header)) {
+                    uint32_t length;
+                    memcpy(&length, header, sizeof(length));
+                    body_length = ntohl(length);
+                    if (body_length > kMaxFrameSize) {
+                        failed = true;
+                        break;
+                    }
+                    body = pool.acquire();
+                    body.resize(body_length);
+                    body_received = 0;
+                    state = State::Body;
+                    if (body_length == 0) {
+                        completeFrame();
+                    }
+                }
+            }
+            else {
+                size_t n = std::min(len, static_cast<size_t>(body_length) - body_received);
+                memcpy(&body[body_received], data, n);
+                body_received += n;
+                data += n;
+                len -= n;
+
+                if (body_received == body_length) {
+                    completeFrame();
+                }
+            }
+        }
+        return !failed;
+    }
+
+    bool hasFrame() const { return !frames.empty(); }
+
+    std::string takeFrame() {
+        std::string frame = std::move(frames.front());
+        frames.pop_front();
+        return frame;
+    }
+
+    // 正在等待数据的半包字节数
+    size_t pendingBytes() const {
+        return state == State::Header ? header_received : sizeof(header) + body_received;
+    }
+
+private:
+    enum class State { Header, Body };
+
+    BufferPool& pool;
+    State state;
+    char header[4];
+    size_t header_received;
+    std::string body;
+    size_t body_received;
+    uint32_t body_length;
+    bool failed;
+    std::deque<std::string> frames;
+
+    void completeFrame() {
+        frames.push_back(std::move(body));
+        body = std::string();
+        header_received = 0;
+        body_received = 0;
+        body_length = 0;
+        state = State::Header;
+    }
+};
+
+#endif // FRAME_DECODER_H
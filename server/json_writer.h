@@ -0,0 +1,193 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <charconv>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "frame_decoder.h"
+
+// 流式JSON帧写入器
+// 一开始就预留4字节长度头，键和值直接追加到帧缓冲区，finish()回填长度后得到可以直接发送的共享帧。
+// 不构造中间的nlohmann::json对象；数据库绑定缓冲区中的字符串以string_view传入，逐行写出时没有堆分配。
+// 输出与nlohmann::json::dump()逐字节一致: 紧凑格式，转义规则相同，不转义非ASCII字符。
+// 键的顺序由调用方保证，需要与dump()一致时按字母序写出。非法UTF-8替换为U+FFFD。
+class JsonFrameWriter {
+public:
+    explicit JsonFrameWriter(size_t capacity = 256)
+        : frame(std::make_shared<std::string>()), need_comma(false) {
+        frame->reserve(sizeof(uint32_t) + capacity);
+        frame->append(sizeof(uint32_t), '\0');
+    }
+
+    // 作用域内写出一个JSON数组，任何返回路径上都会闭合
+    class ArrayScope {
+    public:
+        explicit ArrayScope(JsonFrameWriter& out) : out(out) { out.beginArray(); }
+        ~ArrayScope() { out.endArray(); }
+        ArrayScope(const ArrayScope&) = delete;
+        ArrayScope& operator=(const ArrayScope&) = delete;
+
+    private:
+        JsonFrameWriter& out;
+    };
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    void key(std::string_view name) {
+        separate();
+        writeString(name);
+        frame->push_back(':');
+        need_comma = false;
+    }
+
+    void value(int number) {
+        separate();
+        char buf[16];
+        auto result = std::to_chars(buf, buf + sizeof(buf), number);
+        frame->append(buf, result.ptr - buf);
+        need_comma = true;
+    }
+
+    void value(bool flag) {
+        separate();
+        frame->append(flag ? "true" : "false");
+        need_comma = true;
+    }
+
+    void value(std::string_view text) {
+        separate();
+        writeString(text);
+        need_comma = true;
+    }
+
+    // 避免字符串字面量被隐式转换为bool
+    void value(const char* text) { value(std::string_view(text)); }
+
+    // 已写入的JSON长度(不含长度头)
+    size_t size() const { return frame->size() - sizeof(uint32_t); }
+
+    // 回填长度头，之后不能再写入
+    SharedFrame finish() {
+        uint32_t length = htonl(static_cast<uint32_t>(size()));
+        memcpy(&(*frame)[0], &length, sizeof(length));
+        return std::move(frame);
+    }
+
+private:
+    std::shared_ptr<std::string> frame;
+    bool need_comma;    // 下一个元素前需要逗号
+
+    void separate() {
+        if (need_comma) {
+            frame->push_back(',');
+        }
+    }
+
+    void open(char bracket) {
+        separate();
+        frame->push_back(bracket);
+        need_comma = false;
+    }
+
+    void close(char bracket) {
+        frame->push_back(bracket);
+        need_comma = true;
+    }
+
+    void writeString(std::string_view text) {
+        static const char kHex[] = "0123456789abcdef";
+        frame->push_back('"');
+        size_t i = 0;
+        while (i < text.size()) {
+            // 不需要转义的ASCII连续片段整体追加
+            size_t run = i;
+            while (run < text.size()) {
+                unsigned char c = static_cast<unsigned char>(text[run]);
+                if (c < 0x20 || c == '"' || c == '\\' || c >= 0x80) {
+                    break;
+                }
+                ++run;
+            }
+            frame->append(text.data() + i, run - i);
+            i = run;
+            if (i == text.size()) {
+                break;
+            }
+
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x80) {
+                size_t length = utf8Length(text, i);
+                if (length) {
+                    frame->append(text.data() + i, length);
+                    i += length;
+                }
+                else {
+                    frame->append("\xEF\xBF\xBD");
+                    ++i;
+                }
+                continue;
+            }
+
+            switch (c) {
+            case '"': frame->append("\\\""); break;
+            case '\\': frame->append("\\\\"); break;
+            case '\b': frame->append("\\b"); break;
+            case '\f': frame->append("\\f"); break;
+            case '\n': frame->append("\\n"); break;
+            case '\r': frame->append("\\r"); break;
+            case '\t': frame->append("\\t"); break;
+            default: {
+                char escaped[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+                frame->append(escaped, sizeof(escaped));
+                break;
+            }
+            }
+            ++i;
+        }
+        frame->push_back('"');
+    }
+
+    // pos处合法UTF-8多字节字符的长度，非法(过长编码、代理项、超过U+10FFFF)时返回0
+    static size_t utf8Length(std::string_view text, size_t pos) {
+        unsigned char lead = static_cast<unsigned char>(text[pos]);
+        size_t length;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) low = 0xA0;
+            if (lead == 0xED) high = 0x9F;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) low = 0x90;
+            if (lead == 0xF4) high = 0x8F;
+        }
+        else {
+            return 0;
+        }
+        if (pos + length > text.size()) {
+            return 0;
+        }
+        for (size_t k = 1; k < length; ++k) {
+            unsigned char c = static_cast<unsigned char>(text[pos + k]);
+            if (c < (k == 1 ? low : 0x80) || c > (k == 1 ? high : 0xBF)) {
+                return 0;
+            }
+        }
+        return length;
+    }
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,545 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+// 顺序统计树(GNU pb_ds)，支持O(log n)的按名次查找和名次计算
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include "frame_decoder.h"
+#include "json_writer.h"
+
+// 排行榜类型
+enum class RankingType {
+    Level,  // 关卡: max_level降序, update_time升序
+    Time,   // 时间: time_seconds升序, create_time升序
+    Step    // 步数: step_count升序, create_time升序
+};
+
+// 排行榜中的一行，与数据库三张排行榜表的查询结果对应
+struct RankingEntry {
+    int id = 0;             // 排行榜表中的行id
+    int user_id = 0;
+    std::string username;
+    std::string nickname;
+    int grid_size = 0;
+    int score = 0;          // max_level / time_seconds / step_count
+    bool used_undo = false;
+    std::string time;       // update_time / create_time, 格式 YYYY-MM-DD HH:MM:SS
+};
+
+inline bool parseRankingType(const std::string& game_type, RankingType& type) {
+    if (game_type == "level") type = RankingType::Level;
+    else if (game_type == "time") type = RankingType::Time;
+    else if (game_type == "step") type = RankingType::Step;
+    else return false;
+    return true;
+}
+
+inline const char* rankingResponseType(RankingType type) {
+    switch (type) {
+    case RankingType::Level: return "level_rankings_response";
+    case RankingType::Time: return "time_rankings_response";
+    default: return "step_rankings_response";
+    }
+}
+
+// 与数据库查询结果相同的JSON格式
+inline nlohmann::json rankingEntryToJson(RankingType type, const RankingEntry& entry) {
+    nlohmann::json row;
+    row["id"] = entry.id;
+    row["user_id"] = entry.user_id;
+    row["username"] = entry.username;
+    row["nickname"] = entry.nickname;
+    if (type == RankingType::Level) {
+        row["max_level"] = entry.score;
+        row["update_time"] = entry.time;
+    }
+    else {
+        row["grid_size"] = entry.grid_size;
+        row[type == RankingType::Time ? "time_seconds" : "step_count"] = entry.score;
+        row["used_undo"] = entry.used_undo;
+        row["create_time"] = entry.time;
+    }
+    return row;
+}
+
+// 流式写出一行，字段与rankingEntryToJson相同，按字母序排列以与dump()的输出一致
+// 字符串直接引用调用方的缓冲区(数据库绑定缓冲区或内存排行榜中的记录)，不复制
+inline void writeRankingRow(JsonFrameWriter& out, RankingType type, int id, int user_id,
+                            std::string_view username, std::string_view nickname,
+                            int grid_size, int score, bool used_undo, std::string_view time) {
+    out.beginObject();
+    if (type == RankingType::Level) {
+        out.key("id"); out.value(id);
+        out.key("max_level"); out.value(score);
+        out.key("nickname"); out.value(nickname);
+        out.key("update_time"); out.value(time);
+    }
+    else {
+        out.key("create_time"); out.value(time);
+        out.key("grid_size"); out.value(grid_size);
+        out.key("id"); out.value(id);
+        out.key("nickname"); out.value(nickname);
+        if (type == RankingType::Step) {
+            out.key("step_count"); out.value(score);
+        }
+        else {
+            out.key("time_seconds"); out.value(score);
+        }
+        out.key("used_undo"); out.value(used_undo);
+    }
+    out.key("user_id"); out.value(user_id);
+    out.key("username"); out.value(username);
+    out.endObject();
+}
+
+inline void writeRankingEntry(JsonFrameWriter& out, RankingType type, const RankingEntry& entry) {
+    writeRankingRow(out, type, entry.id, entry.user_id, entry.username, entry.nickname,
+                    entry.grid_size, entry.score, entry.used_undo, entry.time);
+}
+
+// 每行的大致长度，用于预留帧缓冲区
+constexpr size_t kRankingRowBytes = 160;
+
+// 排行榜响应帧 {"data":[...],"next_cursor":...,"session_id":...,"success":true,"type":...}
+// beginRankingResponse之后由调用方写出data数组，再由finishRankingResponse写出其余字段；
+// next_cursor和session_id为空时省略
+inline void beginRankingResponse(JsonFrameWriter& out) {
+    out.beginObject();
+    out.key("data");
+}
+
+inline SharedFrame finishRankingResponse(JsonFrameWriter& out, RankingType type, const std::string& next_cursor,
+                                         const std::string& session_id = std::string()) {
+    if (!next_cursor.empty()) {
+        out.key("next_cursor");
+        out.value(next_cursor);
+    }
+    if (!session_id.empty()) {
+        out.key("session_id");
+        out.value(session_id);
+    }
+    out.key("success");
+    out.value(true);
+    out.key("type");
+    out.value(rankingResponseType(type));
+    out.endObject();
+    return out.finish();
+}
+
+// 当前时间，格式与MySQL的NOW()一致
+inline std::string formatRankingTime(std::time_t t) {
+    std::tm tm_buf;
+    localtime_r(&t, &tm_buf);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_buf);
+    return buf;
+}
+
+// "YYYY-MM-DD HH:MM:SS" -> YYYYMMDDHHMMSS，与字符串字典序一致
+inline int64_t rankingTimeKey(std::string_view time) {
+    int64_t key = 0;
+    for (char c : time) {
+        if (c >= '0' && c <= '9') {
+            key = key * 10 + (c - '0');
+        }
+    }
+    return key;
+}
+
+// 排行榜分页游标: 上一页最后一行的(分数, 时间, 行id, 用户id)
+// 下一页从严格排在它之后的行开始，深翻页和第一页代价相同。对客户端是不透明字符串。
+// 还在写入队列中的新行id为0，内存排行榜靠用户id区分；数据库中行id唯一，用户id不参与比较
+struct RankingCursor {
+    int score = 0;
+    int64_t time_key = 0;   // YYYYMMDDHHMMSS
+    int id = 0;
+    int user_id = INT_MAX;
+
+    static RankingCursor fromEntry(const RankingEntry& entry) {
+        RankingCursor cursor;
+        cursor.score = entry.score;
+        cursor.time_key = rankingTimeKey(entry.time);
+        cursor.id = entry.id;
+        cursor.user_id = entry.user_id;
+        return cursor;
+    }
+
+    std::string encode() const {
+        char buf[80];
+        snprintf(buf, sizeof(buf), "%d.%lld.%d.%d", score, static_cast<long long>(time_key), id, user_id);
+        return buf;
+    }
+
+    // 兼容没有用户id的三段格式
+    static bool decode(const std::string& token, RankingCursor& cursor) {
+        long long time_key = 0;
+        int consumed = 0;
+        cursor.user_id = INT_MAX;
+        int fields = sscanf(token.c_str(), "%d.%lld.%d%n.%d%n", &cursor.score, &time_key, &cursor.id,
+                            &consumed, &cursor.user_id, &consumed);
+        if (fields < 3 || consumed != static_cast<int>(token.size())) {
+            return false;
+        }
+        cursor.time_key = time_key;
+        return true;
+    }
+
+    // 用于SQL绑定的时间字符串，写入buf，返回长度
+    int formatTime(char* buf, size_t size) const {
+        long long t = time_key;
+        return snprintf(buf, size, "%04lld-%02lld-%02lld %02lld:%02lld:%02lld",
+                        t / 10000000000LL, t / 100000000 % 100, t / 1000000 % 100,
+                        t / 10000 % 100, t / 100 % 100, t % 100);
+    }
+};
+
+// 一个(类型, grid_size, used_undo)组合对应的有序排行榜
+class Leaderboard {
+public:
+    explicit Leaderboard(RankingType type) : type(type) {}
+
+    // 按数据库中的规则合并一次成绩:
+    // 关卡取最大值并刷新update_time；时间/步数取最小值，只有成绩变好才刷新create_time
+    // 重新合并数据库中的记录时可能读到较早的update_time，关卡时间只向后移动
+    void submit(const RankingEntry& entry) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        size_t old_size = index.size();
+        auto it = entries.find(entry.user_id);
+        if (it == entries.end()) {
+            insertLocked(entry);
+            refreshSnapshotsLocked(old_size, index.order_of_key(keyOf(entry)));
+            return;
+        }
+
+        RankingEntry merged = it->second;
+        merged.username = entry.username;
+        merged.nickname = entry.nickname;
+        if (entry.id != 0) {
+            merged.id = entry.id;
+        }
+        if (type == RankingType::Level) {
+            merged.score = std::max(merged.score, entry.score);
+            merged.time = std::max(merged.time, entry.time);
+        }
+        else if (entry.score < merged.score) {
+            merged.score = entry.score;
+            merged.time = entry.time;
+        }
+
+        RankKey old_key = keyOf(it->second);
+        RankKey new_key = keyOf(merged);
+        if (old_key == new_key) {
+            it->second = merged;
+            return;
+        }
+        size_t old_pos = index.order_of_key(old_key);
+        index.erase(old_key);
+        it->second = merged;
+        index.insert(new_key);
+        refreshSnapshotsLocked(old_size, std::min(old_pos, index.order_of_key(new_key)));
+    }
+
+    // 启动加载时直接放入，不做合并
+    void load(const RankingEntry& entry) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = entries.find(entry.user_id);
+        if (it != entries.end()) {
+            index.erase(keyOf(it->second));
+            entries.erase(it);
+        }
+        insertLocked(entry);
+        for (auto& slot : snapshots) {
+            std::atomic_store(&slot.frame, SharedFrame());
+        }
+    }
+
+    // 从after之后(为空则从第一名)开始的limit行作为JSON数组写入out，O(log n + limit)
+    // 还有更多数据时next_cursor为最后一行的游标，否则为空
+    void writePage(JsonFrameWriter& out, const RankingCursor* after, int limit, std::string& next_cursor) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        writePageLocked(out, after, limit, next_cursor);
+    }
+
+    // 热门视图(第一页，limit为kSnapshotLimits之一)的完整响应帧，不是热门视图时返回空
+    // 读取只有一次原子load；快照由修改了前limit名的submit在写锁内重建，读写互不阻塞
+    SharedFrame snapshot(int limit) const {
+        Snapshot* slot = findSnapshot(limit);
+        if (!slot) {
+            return SharedFrame();
+        }
+        SharedFrame frame = std::atomic_load(&slot->frame);
+        if (frame) {
+            return frame;
+        }
+
+        // 第一次读取时生成，之后由submit维护
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        frame = std::atomic_load(&slot->frame);
+        if (!frame) {
+            frame = buildSnapshotLocked(limit);
+            std::atomic_store(&slot->frame, frame);
+        }
+        return frame;
+    }
+
+    // 用户名次(从1开始)，不在榜上返回0，O(log n)
+    int rankOf(int user_id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = entries.find(user_id);
+        if (it == entries.end()) {
+            return 0;
+        }
+        return static_cast<int>(index.order_of_key(keyOf(it->second))) + 1;
+    }
+
+    // 用户名次及其前后各count名，O(log n + count)
+    // 返回用户名次(从1开始)，不在榜上返回0；first_rank为window中第一行的名次
+    int around(int user_id, int count, std::vector<RankingEntry>& window, int& first_rank, int& total) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        total = static_cast<int>(index.size());
+        first_rank = 0;
+        auto found = entries.find(user_id);
+        if (found == entries.end()) {
+            return 0;
+        }
+
+        int rank = static_cast<int>(index.order_of_key(keyOf(found->second))) + 1;
+        first_rank = std::max(1, rank - count);
+        int last_rank = std::min(total, rank + count);
+        window.reserve(last_rank - first_rank + 1);
+        auto it = index.find_by_order(first_rank - 1);
+        for (int r = first_rank; r <= last_rank && it != index.end(); ++r, ++it) {
+            window.push_back(entries.at(std::get<3>(*it)));
+        }
+        return rank;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return index.size();
+    }
+
+    static constexpr std::array<int, 4> kSnapshotLimits = {{10, 20, 50, 100}};
+
+private:
+    // 排序键: (分数, 时间, 行id, user_id)，关卡分数取负以统一升序
+    using RankKey = std::tuple<int, int64_t, int, int>;
+    using OrderedIndex = __gnu_pbds::tree<RankKey, __gnu_pbds::null_type, std::less<RankKey>,
+                                          __gnu_pbds::rb_tree_tag,
+                                          __gnu_pbds::tree_order_statistics_node_update>;
+
+    struct Snapshot {
+        int limit = 0;
+        SharedFrame frame;  // 只通过std::atomic_load/atomic_store访问，为空表示还没人读过
+    };
+
+    RankingType type;
+    mutable std::shared_mutex mutex;
+    OrderedIndex index;
+    std::unordered_map<int, RankingEntry> entries;  // user_id -> 当前成绩
+    mutable std::array<Snapshot, kSnapshotLimits.size()> snapshots = makeSnapshots();
+
+    static std::array<Snapshot, kSnapshotLimits.size()> makeSnapshots() {
+        std::array<Snapshot, kSnapshotLimits.size()> result;
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i].limit = kSnapshotLimits[i];
+        }
+        return result;
+    }
+
+    Snapshot* findSnapshot(int limit) const {
+        for (auto& slot : snapshots) {
+            if (slot.limit == limit) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    // 直接从entries中的记录写出，不复制行
+    void writePageLocked(JsonFrameWriter& out, const RankingCursor* after, int limit, std::string& next_cursor) const {
+        next_cursor.clear();
+        JsonFrameWriter::ArrayScope array(out);
+        if (limit <= 0) {
+            return;
+        }
+        auto it = index.begin();
+        if (after) {
+            int score = type == RankingType::Level ? -after->score : after->score;
+            it = index.upper_bound(RankKey(score, after->time_key, after->id, after->user_id));
+        }
+        const RankingEntry* last = nullptr;
+        for (int count = 0; it != index.end() && count < limit; ++it, ++count) {
+            last = &entries.at(std::get<3>(*it));
+            writeRankingEntry(out, type, *last);
+        }
+        if (it != index.end() && last) {
+            next_cursor = RankingCursor::fromEntry(*last).encode();
+        }
+    }
+
+    SharedFrame buildSnapshotLocked(int limit) const {
+        JsonFrameWriter out(std::min<size_t>(limit, index.size()) * kRankingRowBytes + 128);
+        std::string next_cursor;
+        beginRankingResponse(out);
+        writePageLocked(out, nullptr, limit, next_cursor);
+        return finishRankingResponse(out, type, next_cursor);
+    }
+
+    // 一次修改影响的最靠前位置为first_changed(从0开始)；只重建已经有人读过且前limit名发生变化的快照。
+    // 总数越过limit时next_cursor也会变化。
+    void refreshSnapshotsLocked(size_t old_size, size_t first_changed) {
+        for (auto& slot : snapshots) {
+            size_t limit = static_cast<size_t>(slot.limit);
+            bool top_changed = first_changed < limit;
+            bool more_changed = (old_size > limit) != (index.size() > limit);
+            if ((top_changed || more_changed) && std::atomic_load(&slot.frame)) {
+                std::atomic_store(&slot.frame, buildSnapshotLocked(slot.limit));
+            }
+        }
+    }
+
+    RankKey keyOf(const RankingEntry& entry) const {
+        int score = type == RankingType::Level ? -entry.score : entry.score;
+        return RankKey(score, rankingTimeKey(entry.time), entry.id, entry.user_id);
+    }
+
+    void insertLocked(const RankingEntry& entry) {
+        entries[entry.user_id] = entry;
+        index.insert(keyOf(entry));
+    }
+};
+
+// 内存排行榜引擎
+// 每个(类型, grid_size, used_undo)一个有序索引，启动时从数据库加载，
+// 提交成绩时同步更新；读取排行榜和名次不再访问数据库，MySQL仍是持久化存储。
+class LeaderboardEngine {
+public:
+    LeaderboardEngine() : boards(std::make_shared<BoardMap>()), ready(false) {}
+
+    Leaderboard& board(RankingType type, int grid_size, bool used_undo) {
+        BoardKey key = makeKey(type, grid_size, used_undo);
+        if (Leaderboard* found = findMutable(key)) {
+            return *found;
+        }
+
+        // 新排行榜很少出现，复制整个表后原子替换，读取方始终看到完整的表
+        std::lock_guard<std::mutex> lock(create_mutex);
+        if (Leaderboard* found = findMutable(key)) {
+            return *found;
+        }
+        auto updated = std::make_shared<BoardMap>(*std::atomic_load(&boards));
+        auto created = std::make_shared<Leaderboard>(type);
+        (*updated)[key] = created;
+        std::atomic_store(&boards, std::shared_ptr<const BoardMap>(updated));
+        return *created;
+    }
+
+    void submit(RankingType type, const RankingEntry& entry) {
+        board(type, entry.grid_size, entry.used_undo).submit(entry);
+    }
+
+    void load(RankingType type, const RankingEntry& entry) {
+        board(type, entry.grid_size, entry.used_undo).load(entry);
+    }
+
+    // 一页排行榜作为JSON数组写入out，还有更多数据时next_cursor为最后一行的游标，否则为空
+    void writePage(JsonFrameWriter& out, RankingType type, int grid_size, bool used_undo,
+                   const RankingCursor* after, int limit, std::string& next_cursor) const {
+        const Leaderboard* found = find(type, grid_size, used_undo);
+        if (!found) {
+            next_cursor.clear();
+            out.beginArray();
+            out.endArray();
+            return;
+        }
+        found->writePage(out, after, limit, next_cursor);
+    }
+
+    // 热门排行榜第一页的预编码响应帧，不在快照范围内或排行榜不存在时返回空
+    SharedFrame snapshotFrame(RankingType type, int grid_size, bool used_undo, int limit) const {
+        const Leaderboard* found = find(type, grid_size, used_undo);
+        return found ? found->snapshot(limit) : SharedFrame();
+    }
+
+    // {rank, total, first_rank, rankings}，rankings中每行带rank字段；用户不在榜上时rank为0且rankings为空
+    nlohmann::json aroundJson(RankingType type, int grid_size, bool used_undo, int user_id, int count) const {
+        std::vector<RankingEntry> window;
+        int rank = 0;
+        int first_rank = 0;
+        int total = 0;
+        const Leaderboard* found = find(type, grid_size, used_undo);
+        if (found) {
+            rank = found->around(user_id, count, window, first_rank, total);
+        }
+
+        nlohmann::json rankings = nlohmann::json::array();
+        for (size_t i = 0; i < window.size(); ++i) {
+            nlohmann::json row = rankingEntryToJson(type, window[i]);
+            row["rank"] = first_rank + static_cast<int>(i);
+            rankings.push_back(std::move(row));
+        }
+        return {
+            {"rank", rank},
+            {"total", total},
+            {"first_rank", first_rank},
+            {"rankings", rankings}
+        };
+    }
+
+    // 全部数据加载完成后才对外提供读取，否则调用方应回退到数据库
+    void setReady(bool value) { ready = value; }
+    bool isReady() const { return ready; }
+
+private:
+    using BoardKey = std::tuple<int, int, bool>;
+    using BoardMap = std::map<BoardKey, std::shared_ptr<Leaderboard>>;
+
+    // 写时复制: 读取方用std::atomic_load取得当前的表，不加锁
+    // 排行榜创建后不会删除，替换前后的表共享同一个Leaderboard对象
+    std::shared_ptr<const BoardMap> boards;
+    std::mutex create_mutex;
+    std::atomic<bool> ready;
+
+    Leaderboard* findMutable(const BoardKey& key) const {
+        std::shared_ptr<const BoardMap> current = std::atomic_load(&boards);
+        auto it = current->find(key);
+        return it != current->end() ? it->second.get() : nullptr;
+    }
+
+    // 只读查询不创建新的排行榜，避免任意grid_size请求占用内存
+    const Leaderboard* find(RankingType type, int grid_size, bool used_undo) const {
+        return findMutable(makeKey(type, grid_size, used_undo));
+    }
+
+    // 关卡排行榜不区分grid_size和used_undo
+    static BoardKey makeKey(RankingType type, int grid_size, bool used_undo) {
+        if (type == RankingType::Level) {
+            return BoardKey(static_cast<int>(type), 0, false);
+        }
+        return BoardKey(static_cast<int>(type), grid_size, used_undo);
+    }
+};
+
+#endif // LEADERBOARD_H
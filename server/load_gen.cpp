@@ -0,0 +1,676 @@
+// 拼图游戏服务器负载生成器
+// 按协议(4字节长度头 + JSON)建立多个并发连接，以固定的目标速率发送登录、排行榜查询、成绩提交等请求，
+// 统计吞吐量和p50/p99/p999延迟。
+//
+// 开环压测: 请求按预定时间发出，不等待上一个响应，服务器变慢时请求在连接上排队而不是降低发送速率；
+// 延迟从预定发送时间算起，包含排队时间，不会因为服务器卡顿少发请求而低估尾延迟。
+//
+// 编译:
+//   g++ -std=c++17 -O2 -o load_gen load_gen.cpp -pthread
+// 运行:
+//   ./load_gen --host 127.0.0.1 --port 8080 --connections 64 --rate 5000 --seconds 10
+//              [--mix login=1,rankings=6,submit=2,rank=1] [--max-p99-ms 20]
+// 对比多个服务器(例如epoll和io_uring两个后端各起一个实例):
+//   ./load_gen --port 8080,8081 --connections 64 --rate 5000 --seconds 10
+// 依次对每个端口运行相同的负载，最后输出对比表，包括服务器I/O线程每个请求的系统调用次数
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#include <nlohmann/json.hpp>
+
+#include "server_metrics.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// 请求种类，mix中的权重按此顺序
+enum class LoadKind : int {
+    Login,
+    Rankings,   // 随机选择关卡/时间/步数排行榜
+    Submit,
+    Rank,       // get_rankings_around
+    Count
+};
+
+static const char* const kKindNames[] = {"login", "rankings", "submit", "rank"};
+static constexpr int kKindCount = static_cast<int>(LoadKind::Count);
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::vector<int> ports;         // --port给出多个端口时依次压测并对比，port为当前目标
+    int connections = 16;
+    int threads = 4;
+    double rate = 1000;             // 所有连接合计的目标请求数/秒
+    int seconds = 10;
+    int warmup_seconds = 1;         // 预热期间的请求不计入统计
+    std::string user_prefix = "loadgen";
+    std::string password = "loadgen_pw";
+    double max_p99_ms = 0;          // 大于0时，总体p99超过该值以非零状态退出
+    int weights[kKindCount] = {1, 6, 2, 1};
+};
+
+// 每个线程的统计，结束后合并
+struct LoadStats {
+    LatencyHistogram latency[kKindCount + 1];   // 最后一项为全部请求
+    uint64_t errors[kKindCount] = {};
+    uint64_t sent = 0;
+    uint64_t unanswered = 0;        // 结束时仍未收到响应的请求
+    uint64_t disconnects = 0;
+
+    void record(int kind, uint64_t us) {
+        for (LatencyHistogram* h : {&latency[kind], &latency[kKindCount]}) {
+            ++h->counts[LatencyHistogram::bucketIndex(us)];
+            ++h->count;
+            h->sum += us;
+            h->max = std::max(h->max, us);
+        }
+    }
+
+    void merge(const LoadStats& other) {
+        for (int k = 0; k <= kKindCount; ++k) {
+            for (int i = 0; i < LatencyHistogram::kBuckets; ++i) {
+                latency[k].counts[i] += other.latency[k].counts[i];
+            }
+            latency[k].count += other.latency[k].count;
+            latency[k].sum += other.latency[k].sum;
+            latency[k].max = std::max(latency[k].max, other.latency[k].max);
+        }
+        for (int k = 0; k < kKindCount; ++k) {
+            errors[k] += other.errors[k];
+        }
+        sent += other.sent;
+        unanswered += other.unanswered;
+        disconnects += other.disconnects;
+    }
+};
+
+// 一个客户端连接，请求可以连续发出，服务器按请求顺序返回响应
+struct LoadConnection {
+    struct InFlight {
+        Clock::time_point intended;     // 预定发送时间
+        int kind;
+        bool measured;                  // 预热期间发出的请求不统计
+    };
+
+    int fd = -1;
+    int user_id = 0;
+    std::string username;
+    std::string session_id;
+    std::string output;
+    size_t output_sent = 0;
+    std::string input;
+    std::deque<InFlight> in_flight;
+    bool closed = false;
+};
+
+// "login=1,rankings=6"形式，未出现的种类保持原权重
+static void parseWeights(const std::string& text, int* weights) {
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        std::string name = item.substr(0, eq);
+        for (int k = 0; k < kKindCount; ++k) {
+            if (name == kKindNames[k]) {
+                weights[k] = std::max(0, std::stoi(item.substr(eq + 1)));
+            }
+        }
+    }
+}
+
+static bool parseArgs(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            std::cout << "用法: " << argv[0] << " [--host H] [--port P[,P2...]] [--connections N] [--threads T]\n"
+                      << "       [--rate R] [--seconds S] [--warmup S] [--user-prefix U] [--password W]\n"
+                      << "       [--mix login=1,rankings=6,submit=2,rank=1] [--max-p99-ms M]" << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") {
+            options.ports.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                options.ports.push_back(std::stoi(item));
+            }
+        }
+        else if (arg == "--connections") options.connections = std::max(1, std::stoi(value));
+        else if (arg == "--threads") options.threads = std::max(1, std::stoi(value));
+        else if (arg == "--rate") options.rate = std::stod(value);
+        else if (arg == "--seconds") options.seconds = std::stoi(value);
+        else if (arg == "--warmup") options.warmup_seconds = std::stoi(value);
+        else if (arg == "--user-prefix") options.user_prefix = value;
+        else if (arg == "--password") options.password = value;
+        else if (arg == "--mix") parseWeights(value, options.weights);
+        else if (arg == "--max-p99-ms") options.max_p99_ms = std::stod(value);
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.ports.empty()) {
+        options.ports.push_back(options.port);
+    }
+    if (options.rate <= 0) {
+        std::cerr << "--rate必须大于0" << std::endl;
+        return false;
+    }
+    if (std::all_of(options.weights, options.weights + kKindCount, [](int w) { return w == 0; })) {
+        std::cerr << "--mix中至少有一种请求的权重大于0" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static int connectTo(const LoadOptions& options) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(options.host.c_str(), std::to_string(options.port).c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd != -1 && connect(fd, result->ai_addr, result->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd != -1) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static void appendFrame(std::string& out, const std::string& payload) {
+    uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out += payload;
+}
+
+// 从input中取出一帧，没有完整帧时返回false
+static bool takeFrame(std::string& input, std::string& frame) {
+    if (input.size() < 4) {
+        return false;
+    }
+    uint32_t length;
+    memcpy(&length, input.data(), sizeof(length));
+    length = ntohl(length);
+    if (input.size() < 4 + static_cast<size_t>(length)) {
+        return false;
+    }
+    frame.assign(input, 4, length);
+    input.erase(0, 4 + static_cast<size_t>(length));
+    return true;
+}
+
+// 阻塞方式的一问一答，只在准备阶段使用
+static bool blockingCall(int fd, const json& request, json& response) {
+    std::string out;
+    appendFrame(out, request.dump());
+    if (send(fd, out.data(), out.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(out.size())) {
+        return false;
+    }
+    std::string input;
+    std::string frame;
+    while (!takeFrame(input, frame)) {
+        char buf[4096];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            return false;
+        }
+        input.append(buf, static_cast<size_t>(n));
+    }
+    response = json::parse(frame, nullptr, false);
+    return response.is_object();
+}
+
+// 注册(已存在时忽略失败)并登录，取得会话令牌
+static bool prepareConnection(const LoadOptions& options, int index, LoadConnection& conn) {
+    conn.fd = connectTo(options);
+    if (conn.fd == -1) {
+        std::cerr << "连接 " << options.host << ":" << options.port << " 失败: " << strerror(errno) << std::endl;
+        return false;
+    }
+    conn.username = options.user_prefix + "_" + std::to_string(index);
+
+    json response;
+    json request = {
+        {"type", "register"},
+        {"data", {{"username", conn.username}, {"password", options.password}, {"nickname", conn.username}}}
+    };
+    if (!blockingCall(conn.fd, request, response)) {
+        return false;
+    }
+    request = {
+        {"type", "login"},
+        {"data", {{"username", conn.username}, {"password", options.password}}}
+    };
+    if (!blockingCall(conn.fd, request, response) || !response.value("success", false)) {
+        std::cerr << conn.username << " 登录失败: " << response.value("message", std::string()) << std::endl;
+        return false;
+    }
+    conn.user_id = response["data"]["user_id"];
+    conn.session_id = response["data"]["session_id"];
+
+    int flags = fcntl(conn.fd, F_GETFL, 0);
+    fcntl(conn.fd, F_SETFL, flags | O_NONBLOCK);
+    return true;
+}
+
+static std::string buildRequest(LoadKind kind, const LoadConnection& conn, const LoadOptions& options,
+                                std::mt19937& rng) {
+    static const char* const game_types[] = {"level", "time", "step"};
+    int grid_size = 3 + static_cast<int>(rng() % 4);
+    bool used_undo = (rng() & 1) != 0;
+    const char* game_type = game_types[rng() % 3];
+
+    json request;
+    switch (kind) {
+    case LoadKind::Login:
+        request = {
+            {"type", "login"},
+            {"data", {{"username", conn.username}, {"password", options.password}}}
+        };
+        break;
+    case LoadKind::Rankings:
+        request = {
+            {"type", std::string("get_") + game_type + "_rankings"},
+            {"data", {{"grid_size", grid_size}, {"used_undo", used_undo}, {"limit", 50}}}
+        };
+        break;
+    case LoadKind::Submit:
+        request = {
+            {"type", "submit_game_result"},
+            {"data", {
+                {"user_id", conn.user_id},
+                {"session_id", conn.session_id},
+                {"game_type", game_type},
+                {"grid_size", grid_size},
+                {"max_level", 1 + static_cast<int>(rng() % 20)},
+                {"time_seconds", 30 + static_cast<int>(rng() % 600)},
+                {"step_count", 20 + static_cast<int>(rng() % 400)},
+                {"used_undo", used_undo}
+            }}
+        };
+        break;
+    default:
+        request = {
+            {"type", "get_rankings_around"},
+            {"data", {
+                {"session_id", conn.session_id},
+                {"game_type", game_type},
+                {"grid_size", grid_size},
+                {"used_undo", used_undo},
+                {"range", 5}
+            }}
+        };
+        break;
+    }
+    return request.dump();
+}
+
+// 写出连接上待发送的数据，返回false表示连接已断开
+static bool flushConnection(LoadConnection& conn) {
+    while (conn.output_sent < conn.output.size()) {
+        ssize_t n = send(conn.fd, conn.output.data() + conn.output_sent,
+                         conn.output.size() - conn.output_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        conn.output_sent += static_cast<size_t>(n);
+    }
+    if (conn.output_sent == conn.output.size()) {
+        conn.output.clear();
+        conn.output_sent = 0;
+    }
+    return true;
+}
+
+// 读取响应并按请求顺序匹配，返回false表示连接已断开
+static bool readResponses(LoadConnection& conn, LoadStats& stats) {
+    bool open = true;
+    while (true) {
+        char buf[64 * 1024];
+        ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn.input.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        open = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        break;
+    }
+
+    Clock::time_point now = Clock::now();
+    std::string frame;
+    while (takeFrame(conn.input, frame) && !conn.in_flight.empty()) {
+        LoadConnection::InFlight request = conn.in_flight.front();
+        conn.in_flight.pop_front();
+        if (!request.measured) {
+            continue;
+        }
+        uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(now - request.intended).count();
+        stats.record(request.kind, us);
+        // 只查找success字段，不做完整解析，避免压测端自身成为瓶颈
+        if (frame.find("\"success\":true") == std::string::npos) {
+            ++stats.errors[request.kind];
+        }
+    }
+    return open;
+}
+
+// 一个压测线程: 管理自己的一组连接，按固定间隔轮流在各连接上发出请求
+static void runLoad(const LoadOptions& options, std::vector<LoadConnection>& conns, double rate,
+                    Clock::time_point measure_from, Clock::time_point end, unsigned seed, LoadStats& stats) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    for (size_t i = 0; i < conns.size(); ++i) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> pick(options.weights, options.weights + kKindCount);
+    auto interval = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate));
+    Clock::time_point next_send = Clock::now();
+    size_t next_conn = 0;
+    size_t open_conns = conns.size();
+
+    while (open_conns > 0) {
+        Clock::time_point now = Clock::now();
+        if (now >= end) {
+            break;
+        }
+
+        // 补发所有已到预定时间的请求，预定时间不因发送滞后而推迟
+        while (next_send <= now) {
+            LoadConnection* conn = nullptr;
+            for (size_t tries = 0; tries < conns.size() && !conn; ++tries) {
+                LoadConnection& candidate = conns[next_conn++ % conns.size()];
+                if (!candidate.closed) {
+                    conn = &candidate;
+                }
+            }
+            if (!conn) {
+                break;
+            }
+            LoadKind kind = static_cast<LoadKind>(pick(rng));
+            appendFrame(conn->output, buildRequest(kind, *conn, options, rng));
+            conn->in_flight.push_back({next_send, static_cast<int>(kind), next_send >= measure_from});
+            if (next_send >= measure_from) {
+                ++stats.sent;
+            }
+            if (!flushConnection(*conn)) {
+                conn->closed = true;
+                --open_conns;
+                ++stats.disconnects;
+            }
+            next_send += interval;
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_send - Clock::now()).count();
+        epoll_event events[64];
+        int n = epoll_wait(epoll_fd, events, 64, static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(wait, 100))));
+        for (int i = 0; i < n; ++i) {
+            LoadConnection& conn = conns[events[i].data.u64];
+            if (conn.closed) {
+                continue;
+            }
+            bool ok = true;
+            if (events[i].events & EPOLLOUT) {
+                ok = flushConnection(conn);
+            }
+            if (ok && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                ok = readResponses(conn, stats);
+            }
+            if (!ok) {
+                conn.closed = true;
+                --open_conns;
+                ++stats.disconnects;
+            }
+        }
+    }
+
+    // 等待已发出的请求返回，最多1秒
+    Clock::time_point drain_end = Clock::now() + std::chrono::seconds(1);
+    auto pending = [&conns]() {
+        size_t total = 0;
+        for (const LoadConnection& conn : conns) {
+            total += conn.closed ? 0 : conn.in_flight.size();
+        }
+        return total;
+    };
+    while (pending() > 0 && Clock::now() < drain_end) {
+        epoll_event events[64];
+        int n = epoll_wait(epoll_fd, events, 64, 10);
+        for (int i = 0; i < n; ++i) {
+            LoadConnection& conn = conns[events[i].data.u64];
+            if (!conn.closed && !(flushConnection(conn) && readResponses(conn, stats))) {
+                conn.closed = true;
+            }
+        }
+    }
+    for (const LoadConnection& conn : conns) {
+        for (const LoadConnection::InFlight& request : conn.in_flight) {
+            stats.unanswered += request.measured ? 1 : 0;
+        }
+    }
+    close(epoll_fd);
+}
+
+static void printRow(const std::string& name, const LatencyHistogram& h, uint64_t errors, double seconds) {
+    auto ms = [](uint64_t us) { return us / 1000.0; };
+    std::cout << std::left << std::setw(10) << name
+              << std::right << std::setw(10) << h.count
+              << std::setw(10) << std::fixed << std::setprecision(0) << h.count / seconds
+              << std::setw(8) << errors
+              << std::setw(10) << std::setprecision(2) << ms(h.percentile(0.5))
+              << std::setw(10) << ms(h.percentile(0.99))
+              << std::setw(10) << ms(h.percentile(0.999))
+              << std::setw(10) << ms(h.max) << std::endl;
+}
+
+// 一个目标服务器的压测结果，多个目标时用于对比
+struct TargetResult {
+    int port = 0;
+    std::string backend = "-";      // 服务器的网络后端(server_stats中的io_backend)
+    LoadStats total;
+    int64_t io_syscalls = -1;       // 测量期间(不含预热)服务器I/O线程的系统调用次数，取不到时为-1
+    int status = 0;                 // 0正常，2有请求未响应或连接断开，3 p99超过阈值
+};
+
+// 通过server_stats读取服务器的网络后端和I/O系统调用计数
+static bool queryServerStats(const LoadOptions& options, std::string& backend, uint64_t& io_syscalls) {
+    int fd = connectTo(options);
+    if (fd == -1) {
+        return false;
+    }
+    json response;
+    bool ok = blockingCall(fd, {{"type", "server_stats"}, {"data", json::object()}}, response) &&
+              response.value("success", false) && response["data"].contains("io_syscalls");
+    close(fd);
+    if (ok) {
+        backend = response["data"].value("io_backend", std::string("-"));
+        io_syscalls = response["data"]["io_syscalls"].get<uint64_t>();
+    }
+    return ok;
+}
+
+// 对options.port运行一轮压测并输出结果，准备阶段失败时返回false
+static bool runTarget(const LoadOptions& options, TargetResult& result) {
+    result.port = options.port;
+    std::cout << "目标 " << options.host << ":" << options.port
+              << ", 准备 " << options.connections << " 个连接..." << std::endl;
+    std::vector<std::vector<LoadConnection>> groups(options.threads);
+    for (int i = 0; i < options.connections; ++i) {
+        LoadConnection conn;
+        if (!prepareConnection(options, i, conn)) {
+            return false;
+        }
+        groups[i % options.threads].push_back(std::move(conn));
+    }
+
+    std::cout << "目标速率 " << options.rate << " 请求/秒, 预热 " << options.warmup_seconds
+              << " 秒, 测量 " << options.seconds << " 秒, 线程 " << options.threads << std::endl;
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point measure_from = start + std::chrono::seconds(options.warmup_seconds);
+    Clock::time_point end = measure_from + std::chrono::seconds(options.seconds);
+    std::vector<LoadStats> thread_stats(options.threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < options.threads; ++t) {
+        double share = options.rate * groups[t].size() / options.connections;
+        threads.emplace_back([&, t, share]() {
+            runLoad(options, groups[t], share, measure_from, end, 12345u + t, thread_stats[t]);
+        });
+    }
+
+    // 系统调用计数在预热结束时开始取，与total.sent一样只包含测量期间发出的请求
+    uint64_t syscalls_before = 0;
+    std::this_thread::sleep_until(measure_from);
+    bool has_stats = queryServerStats(options, result.backend, syscalls_before);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    uint64_t syscalls_after = 0;
+    if (has_stats && queryServerStats(options, result.backend, syscalls_after)) {
+        result.io_syscalls = static_cast<int64_t>(syscalls_after - syscalls_before);
+    }
+
+    LoadStats& total = result.total;
+    for (const LoadStats& stats : thread_stats) {
+        total.merge(stats);
+    }
+    for (auto& group : groups) {
+        for (LoadConnection& conn : group) {
+            close(conn.fd);
+        }
+    }
+
+    double seconds = options.seconds;
+    std::cout << "发出 " << total.sent << " 个请求, 未响应 " << total.unanswered
+              << ", 断开连接 " << total.disconnects << std::endl;
+    std::cout << "延迟单位: 毫秒，从预定发送时间算起" << std::endl;
+    std::cout << std::left << std::setw(10) << "kind"
+              << std::right << std::setw(10) << "count"
+              << std::setw(10) << "rps"
+              << std::setw(8) << "errors"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "p999"
+              << std::setw(10) << "max" << std::endl;
+    uint64_t all_errors = 0;
+    for (int k = 0; k < kKindCount; ++k) {
+        if (total.latency[k].count > 0) {
+            printRow(kKindNames[k], total.latency[k], total.errors[k], seconds);
+        }
+        all_errors += total.errors[k];
+    }
+    printRow("all", total.latency[kKindCount], all_errors, seconds);
+    if (result.io_syscalls >= 0 && total.sent > 0) {
+        std::cout << "服务器网络后端 " << result.backend << ", I/O系统调用 " << result.io_syscalls
+                  << " 次, 每请求 " << std::setprecision(3)
+                  << static_cast<double>(result.io_syscalls) / total.sent << " 次" << std::endl;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+
+    // 有请求未响应、连接断开或p99超过阈值时以非零状态退出，便于在部署脚本中判断
+    double p99_ms = total.latency[kKindCount].percentile(0.99) / 1000.0;
+    if (total.unanswered > 0 || total.disconnects > 0) {
+        result.status = 2;
+    }
+    else if (options.max_p99_ms > 0 && p99_ms > options.max_p99_ms) {
+        std::cout << "p99 " << p99_ms << "ms 超过阈值 " << options.max_p99_ms << "ms" << std::endl;
+        result.status = 3;
+    }
+    return true;
+}
+
+static void printComparison(const std::vector<TargetResult>& results, double seconds) {
+    auto ms = [](uint64_t us) { return us / 1000.0; };
+    std::cout << "\n对比(延迟单位: 毫秒)" << std::endl;
+    std::cout << std::left << std::setw(8) << "port"
+              << std::setw(10) << "backend"
+              << std::right << std::setw(10) << "rps"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "p999"
+              << std::setw(14) << "syscalls/req" << std::endl;
+    for (const TargetResult& result : results) {
+        const LatencyHistogram& h = result.total.latency[kKindCount];
+        std::cout << std::left << std::setw(8) << result.port
+                  << std::setw(10) << result.backend
+                  << std::right << std::fixed << std::setprecision(0) << std::setw(10) << h.count / seconds
+                  << std::setprecision(2)
+                  << std::setw(10) << ms(h.percentile(0.5))
+                  << std::setw(10) << ms(h.percentile(0.99))
+                  << std::setw(10) << ms(h.percentile(0.999));
+        if (result.io_syscalls >= 0 && result.total.sent > 0) {
+            std::cout << std::setw(14) << std::setprecision(3)
+                      << static_cast<double>(result.io_syscalls) / result.total.sent;
+        }
+        else {
+            std::cout << std::setw(14) << "-";
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        return 1;
+    }
+    options.threads = std::min(options.threads, options.connections);
+
+    std::vector<TargetResult> results;
+    int status = 0;
+    for (int port : options.ports) {
+        options.port = port;
+        if (results.size() > 0) {
+            std::cout << std::endl;
+        }
+        results.emplace_back();
+        if (!runTarget(options, results.back())) {
+            return 1;
+        }
+        status = std::max(status, results.back().status);
+    }
+    if (results.size() > 1) {
+        printComparison(results, options.seconds);
+    }
+    return status;
+}
@@ -0,0 +1,590 @@
+#ifndef LOG_DATABASE_H
+#define LOG_DATABASE_H
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "append_log.h"
+#include "logger.h"
+#include "memory_database.h"
+#include "server_config.h"
+
+// 日志+快照存储后端
+// - 数据全部在内存中(复用MemoryDatabase的表结构、合并规则和分页)，写操作同时追加到日志
+// - 注册和成绩提交等日志组提交落盘后才返回；登录时间只追加不等待，随下一次提交或定时flush写出
+// - 日志超过storage_compact_bytes时把全部数据写成快照并切换到新一代日志，删除旧日志
+// - 启动时mmap快照，再按顺序重放比快照新的日志；最后一个日志的损坏尾部(写入中途宕机)被截掉，
+//   其他位置的损坏直接启动失败，避免静默丢数据
+//
+// 目录结构(storage_path):
+//   snapshot.dat   快照，覆盖到第gen代日志为止的全部写入
+//   log.<gen>      日志，gen大于快照的才需要重放
+//   LOCK           flock互斥，防止两个进程使用同一目录
+class LogDatabase : public MemoryDatabase {
+public:
+    explicit LogDatabase(const ServerConfig& config)
+        : dir(config.storage_path), compact_bytes(config.storage_compact_bytes),
+          log(config.storage_sync), lock_fd(-1), log_gen(0) {
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("无法创建存储目录: " + dir);
+        }
+        lock_fd = open((dir + "/LOCK").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock_fd == -1 || flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+            if (lock_fd != -1) close(lock_fd);
+            throw std::runtime_error("存储目录已被其他进程使用: " + dir);
+        }
+
+        try {
+            recover(config.storage_seed_users);
+        }
+        catch (...) {
+            close(lock_fd);
+            throw;
+        }
+    }
+
+    ~LogDatabase() override {
+        // 正常退出时写一次快照，下次启动不需要重放日志
+        log.flush();
+        if (log.fileBytes() > 0) {
+            compact();
+        }
+        close(lock_fd);
+    }
+
+    bool registerUser(const std::string& username, const std::string& password,
+                      const std::string& nickname, int& user_id) override {
+        uint64_t lsn;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (log.failed() || !registerLocked(username, password, nickname, user_id)) {
+                return false;
+            }
+            lsn = log.append(encodeUser(users.back()));
+        }
+        return waitDurable(lsn);
+    }
+
+    bool loginUser(const std::string& username, const std::string& password,
+                   int& user_id, std::string& nickname) override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!loginLocked(username, password, time(nullptr), user_id, nickname)) {
+            return false;
+        }
+        std::string payload;
+        RecordWriter out(payload);
+        out.put8('L');
+        out.put32(static_cast<uint32_t>(user_id));
+        out.put64(static_cast<uint64_t>(users[user_id - 1].last_login));
+        log.append(payload);
+        return true;
+    }
+
+    // 一批成绩写成一条日志记录，重放时同样整批生效
+    bool submitGameResults(const std::vector<GameResult>& results) override {
+        uint64_t lsn;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (log.failed()) {
+                return false;
+            }
+            for (const GameResult& result : results) {
+                if (!hasUser(result.user_id)) {
+                    return false;
+                }
+            }
+            for (const GameResult& result : results) {
+                applyLocked(result);
+            }
+            lsn = log.append(encodeResults(results.data(), results.size()));
+        }
+        return waitDurable(lsn);
+    }
+
+    bool submitGameResult(int user_id, const std::string& game_type, int grid_size,
+                          int max_level, int time_seconds, int step_count, bool used_undo,
+                          int* row_id = nullptr) override {
+        GameResult result;
+        if (!parseRankingType(game_type, result.type)) {
+            return false;
+        }
+        result.user_id = user_id;
+        result.time = time(nullptr);
+        if (result.type == RankingType::Level) {
+            result.score = max_level;
+        }
+        else {
+            result.grid_size = grid_size;
+            result.score = result.type == RankingType::Time ? time_seconds : step_count;
+            result.used_undo = used_undo;
+        }
+
+        uint64_t lsn;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (log.failed() || !hasUser(user_id)) {
+                return false;
+            }
+            int id = applyLocked(result);
+            if (row_id) {
+                *row_id = id;
+            }
+            lsn = log.append(encodeResults(&result, 1));
+        }
+        return waitDurable(lsn);
+    }
+
+    // 吊销记录落盘后才返回，注销应答之后重启也不会让旧令牌恢复有效
+    bool saveSessionRevocation(int user_id, int64_t revoked_before_ms) override {
+        uint64_t lsn;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            if (log.failed() || !hasUser(user_id)) {
+                return false;
+            }
+            if (!revokeLocked(user_id, revoked_before_ms)) {
+                return true;
+            }
+            lsn = log.append(encodeRevocation(user_id, revoked_before_ms));
+        }
+        return waitDurable(lsn);
+    }
+
+    // 由服务器定时调用: 写出缓冲的登录记录，日志过大时压缩
+    void healthCheck() override {
+        log.flush();
+        if (log.fileBytes() >= compact_bytes) {
+            compact();
+        }
+    }
+
+private:
+    static constexpr char kSnapshotMagic[8] = {'P', 'Z', 'S', 'N', 'A', 'P', '0', '1'};
+
+    std::string dir;
+    uint64_t compact_bytes;
+    AppendLog log;
+    int lock_fd;
+    uint64_t log_gen;           // 当前写入的日志代数
+    std::mutex compact_mutex;   // 同一时间只有一个压缩
+
+    std::string logPath(uint64_t gen) const { return dir + "/log." + std::to_string(gen); }
+    std::string snapshotPath() const { return dir + "/snapshot.dat"; }
+
+    bool waitDurable(uint64_t lsn) {
+        if (!log.waitDurable(lsn)) {
+            LOG_ERROR("写入存储日志失败，之后的写操作全部拒绝: {}", dir);
+            return false;
+        }
+        return true;
+    }
+
+    // ---- 记录编码 ----
+    // 'U' 用户: id, username, password, nickname, last_login
+    // 'L' 登录: user_id, last_login
+    // 'R' 一批成绩: count, 每条(type, user_id, grid_size, score, used_undo, time)
+    // 'W' 快照中的排行榜行: type, id, user_id, grid_size, score, used_undo, time字符串
+    // 'S' 会话吊销: user_id, revoked_before(毫秒)
+    // 'H' 快照头: log_gen, next_row_id, 用户数, 行数
+
+    static std::string encodeUser(const User& user) {
+        std::string payload;
+        RecordWriter out(payload);
+        out.put8('U');
+        out.put32(static_cast<uint32_t>(user.id));
+        out.putString(user.username);
+        out.putString(user.password);
+        out.putString(user.nickname);
+        out.put64(static_cast<uint64_t>(user.last_login));
+        return payload;
+    }
+
+    static std::string encodeRevocation(int user_id, int64_t revoked_before_ms) {
+        std::string payload;
+        RecordWriter out(payload);
+        out.put8('S');
+        out.put32(static_cast<uint32_t>(user_id));
+        out.put64(static_cast<uint64_t>(revoked_before_ms));
+        return payload;
+    }
+
+    static std::string encodeResults(const GameResult* results, size_t count) {
+        std::string payload;
+        RecordWriter out(payload);
+        out.put8('R');
+        out.put32(static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            const GameResult& result = results[i];
+            out.put8(static_cast<uint8_t>(result.type));
+            out.put32(static_cast<uint32_t>(result.user_id));
+            out.put32(static_cast<uint32_t>(result.grid_size));
+            out.put32(static_cast<uint32_t>(result.score));
+            out.put8(result.used_undo ? 1 : 0);
+            out.put64(static_cast<uint64_t>(result.time));
+        }
+        return payload;
+    }
+
+    // 把一条日志或快照记录应用到内存表，格式错误时返回false
+    bool applyRecord(const char* data, size_t size) {
+        RecordReader in(data, size);
+        switch (in.get8()) {
+            case 'U': {
+                User user;
+                user.id = static_cast<int>(in.get32());
+                user.username = in.getString();
+                user.password = in.getString();
+                user.nickname = in.getString();
+                user.last_login = static_cast<std::time_t>(in.get64());
+                int user_id = 0;
+                if (!in.ok() || !registerLocked(user.username, user.password, user.nickname, user_id) ||
+                    user_id != user.id) {
+                    return false;
+                }
+                users.back().last_login = user.last_login;
+                return true;
+            }
+            case 'L': {
+                int user_id = static_cast<int>(in.get32());
+                std::time_t last_login = static_cast<std::time_t>(in.get64());
+                if (!in.ok() || !hasUser(user_id)) {
+                    return false;
+                }
+                users[user_id - 1].last_login = last_login;
+                return true;
+            }
+            case 'R': {
+                uint32_t count = in.get32();
+                std::vector<GameResult> results;
+                for (uint32_t i = 0; i < count && i < size; ++i) {
+                    GameResult result;
+                    uint8_t type = in.get8();
+                    result.user_id = static_cast<int>(in.get32());
+                    result.grid_size = static_cast<int>(in.get32());
+                    result.score = static_cast<int>(in.get32());
+                    result.used_undo = in.get8() != 0;
+                    result.time = static_cast<std::time_t>(in.get64());
+                    if (type > static_cast<uint8_t>(RankingType::Step) || !hasUser(result.user_id)) {
+                        return false;
+                    }
+                    result.type = static_cast<RankingType>(type);
+                    results.push_back(result);
+                }
+                if (!in.ok() || results.size() != count) {
+                    return false;
+                }
+                for (const GameResult& result : results) {
+                    applyLocked(result);
+                }
+                return true;
+            }
+            case 'W': {
+                uint8_t type = in.get8();
+                Row row;
+                row.id = static_cast<int>(in.get32());
+                row.user_id = static_cast<int>(in.get32());
+                row.grid_size = static_cast<int>(in.get32());
+                row.score = static_cast<int>(in.get32());
+                row.used_undo = in.get8() != 0;
+                row.time = in.getString();
+                if (!in.ok() || type > static_cast<uint8_t>(RankingType::Step) || !hasUser(row.user_id)) {
+                    return false;
+                }
+                row.time_key = rankingTimeKey(row.time);
+                tables[type].emplace(RowKey(row.user_id, row.grid_size, row.used_undo), row);
+                return true;
+            }
+            case 'S': {
+                int user_id = static_cast<int>(in.get32());
+                int64_t revoked_before_ms = static_cast<int64_t>(in.get64());
+                if (!in.ok() || !hasUser(user_id)) {
+                    return false;
+                }
+                revokeLocked(user_id, revoked_before_ms);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // ---- 启动恢复 ----
+
+    struct MappedFile {
+        const char* data = nullptr;
+        size_t size = 0;
+
+        ~MappedFile() {
+            if (data && size > 0) munmap(const_cast<char*>(data), size);
+        }
+
+        // 文件不存在时返回false，其他错误抛出异常
+        bool map(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                if (errno == ENOENT) return false;
+                throw std::runtime_error("无法打开存储文件: " + path);
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                throw std::runtime_error("无法读取存储文件: " + path);
+            }
+            size = static_cast<size_t>(st.st_size);
+            if (size > 0) {
+                void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr == MAP_FAILED) {
+                    close(fd);
+                    size = 0;
+                    throw std::runtime_error("mmap存储文件失败: " + path);
+                }
+                madvise(addr, size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(addr);
+            }
+            close(fd);
+            return true;
+        }
+    };
+
+    // 读取快照，返回快照覆盖到的日志代数；没有快照时返回0
+    uint64_t loadSnapshot(size_t& users_loaded, size_t& rows_loaded) {
+        MappedFile file;
+        if (!file.map(snapshotPath())) {
+            return 0;
+        }
+        if (file.size < sizeof(kSnapshotMagic) || memcmp(file.data, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+            throw std::runtime_error("快照文件格式错误: " + snapshotPath());
+        }
+
+        uint64_t gen = 0;
+        uint64_t expected_users = 0;
+        uint64_t expected_rows = 0;
+        bool header = false;
+        const char* body = file.data + sizeof(kSnapshotMagic);
+        size_t body_size = file.size - sizeof(kSnapshotMagic);
+        size_t valid = AppendLog::replay(body, body_size, [&](const char* data, size_t size) {
+            if (!header) {
+                RecordReader in(data, size);
+                bool is_header = in.get8() == 'H';
+                gen = in.get64();
+                next_row_id = static_cast<int>(in.get64());
+                expected_users = in.get64();
+                expected_rows = in.get64();
+                header = is_header && in.ok();
+                return header;
+            }
+            if (!applyRecord(data, size)) {
+                return false;
+            }
+            if (data[0] == 'W') ++rows_loaded;
+            return true;
+        });
+        users_loaded = users.size();
+        if (!header || valid != body_size || users_loaded != expected_users || rows_loaded != expected_rows) {
+            throw std::runtime_error("快照文件损坏: " + snapshotPath());
+        }
+        return gen;
+    }
+
+    // 目录中所有日志的代数，升序
+    std::vector<uint64_t> listLogs() const {
+        std::vector<uint64_t> gens;
+        DIR* d = opendir(dir.c_str());
+        if (!d) {
+            throw std::runtime_error("无法读取存储目录: " + dir);
+        }
+        while (struct dirent* entry = readdir(d)) {
+            const char* name = entry->d_name;
+            if (strncmp(name, "log.", 4) != 0 || name[4] == '\0') {
+                continue;
+            }
+            char* end = nullptr;
+            uint64_t gen = strtoull(name + 4, &end, 10);
+            if (*end == '\0') {
+                gens.push_back(gen);
+            }
+        }
+        closedir(d);
+        std::sort(gens.begin(), gens.end());
+        return gens;
+    }
+
+    void recover(int seed_users) {
+        auto started = std::chrono::steady_clock::now();
+        size_t users_loaded = 0;
+        size_t rows_loaded = 0;
+        uint64_t snapshot_gen = loadSnapshot(users_loaded, rows_loaded);
+        bool empty = users_loaded == 0 && rows_loaded == 0;
+
+        size_t replayed = 0;
+        uint64_t tail_bytes = 0;
+        log_gen = snapshot_gen + 1;
+        std::vector<uint64_t> gens = listLogs();
+        for (size_t i = 0; i < gens.size(); ++i) {
+            uint64_t gen = gens[i];
+            if (gen <= snapshot_gen) {
+                // 压缩后还没来得及删除的旧日志
+                unlink(logPath(gen).c_str());
+                continue;
+            }
+            MappedFile file;
+            file.map(logPath(gen));
+            size_t valid = AppendLog::replay(file.data, file.size, [&](const char* data, size_t size) {
+                if (!applyRecord(data, size)) return false;
+                ++replayed;
+                return true;
+            });
+            bool last = i + 1 == gens.size();
+            if (valid != file.size) {
+                if (!last) {
+                    throw std::runtime_error("存储日志损坏: " + logPath(gen));
+                }
+                LOG_WARN("存储日志尾部不完整，截掉{}字节: {}", file.size - valid, logPath(gen));
+            }
+            empty = empty && valid == 0;
+            log_gen = gen;
+            tail_bytes = valid;
+        }
+
+        if (!log.open(logPath(log_gen), tail_bytes)) {
+            throw std::runtime_error("无法打开存储日志: " + logPath(log_gen));
+        }
+        syncDirectory();
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        LOG_INFO("存储恢复完成: 快照{}个用户{}行，重放日志{}条，耗时{}ms",
+                 users_loaded, rows_loaded, replayed, elapsed);
+
+        // 全新的目录按seed_users生成测试数据，直接写成快照
+        if (empty && seed_users > 0) {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                populate(seed_users, 20240101);
+            }
+            compact();
+        }
+    }
+
+    // ---- 压缩 ----
+
+    void syncDirectory() const {
+        int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    static bool writeAll(int fd, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            ssize_t n = write(fd, data.data() + written, data.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static void appendFramed(std::string& out, const std::string& payload) {
+        uint32_t header[2] = {static_cast<uint32_t>(payload.size()), crc32(payload.data(), payload.size())};
+        out.append(reinterpret_cast<const char*>(header), sizeof(header));
+        out += payload;
+    }
+
+    // 持读锁切换日志并序列化全部数据(期间写操作等待)，解锁后再写文件
+    // 快照rename生效后，之前各代日志已经没有用处，可以删除
+    bool compact() {
+        std::unique_lock<std::mutex> guard(compact_mutex, std::try_to_lock);
+        if (!guard.owns_lock()) {
+            return false;
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        uint64_t covered_gen;
+        std::string snapshot(kSnapshotMagic, sizeof(kSnapshotMagic));
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            covered_gen = log_gen;
+            if (!log.rotate(logPath(covered_gen + 1))) {
+                LOG_ERROR("切换存储日志失败: {}", logPath(covered_gen + 1));
+                return false;
+            }
+            log_gen = covered_gen + 1;
+
+            size_t row_count = tables[0].size() + tables[1].size() + tables[2].size();
+            std::string payload;
+            RecordWriter header(payload);
+            header.put8('H');
+            header.put64(covered_gen);
+            header.put64(static_cast<uint64_t>(next_row_id));
+            header.put64(users.size());
+            header.put64(row_count);
+            appendFramed(snapshot, payload);
+
+            for (const User& user : users) {
+                appendFramed(snapshot, encodeUser(user));
+            }
+            for (int type = 0; type < 3; ++type) {
+                for (const auto& item : tables[type]) {
+                    const Row& row = item.second;
+                    payload.clear();
+                    RecordWriter out(payload);
+                    out.put8('W');
+                    out.put8(static_cast<uint8_t>(type));
+                    out.put32(static_cast<uint32_t>(row.id));
+                    out.put32(static_cast<uint32_t>(row.user_id));
+                    out.put32(static_cast<uint32_t>(row.grid_size));
+                    out.put32(static_cast<uint32_t>(row.score));
+                    out.put8(row.used_undo ? 1 : 0);
+                    out.putString(row.time);
+                    appendFramed(snapshot, payload);
+                }
+            }
+            for (const auto& item : session_revocations) {
+                appendFramed(snapshot, encodeRevocation(item.first, item.second));
+            }
+        }
+        syncDirectory();
+
+        std::string tmp_path = dir + "/snapshot.tmp";
+        int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd != -1 && writeAll(fd, snapshot) && fsync(fd) == 0;
+        if (fd != -1) close(fd);
+        if (!ok || rename(tmp_path.c_str(), snapshotPath().c_str()) != 0) {
+            LOG_ERROR("写入快照失败: {}", tmp_path);
+            unlink(tmp_path.c_str());
+            return false;
+        }
+        syncDirectory();
+
+        for (uint64_t gen : listLogs()) {
+            if (gen <= covered_gen) {
+                unlink(logPath(gen).c_str());
+            }
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        LOG_INFO("存储快照完成: {}字节，覆盖到日志{}，耗时{}ms", snapshot.size(), covered_gen, elapsed);
+        return true;
+    }
+};
+
+#endif // LOG_DATABASE_H
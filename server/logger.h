@@ -0,0 +1,347 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// 日志级别，数值用于编译期比较
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+// 低于该级别的日志语句在编译期删除，参数也不会求值；调试时用-DLOG_MIN_LEVEL=0编译
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+// 配置中的级别名(debug、info、warn、error)，无法识别时返回false
+inline bool parseLogLevel(const std::string& name, int& level) {
+    static const char* const names[] = {"debug", "info", "warn", "error"};
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; ++i) {
+        if (name == names[i]) {
+            level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 用法: LOG_INFO("新连接来自: {}", ip)，每个{}依次替换为一个参数
+#define LOG_AT(level, ...)                                                  \
+    do {                                                                    \
+        if ((level) >= LOG_MIN_LEVEL && Logger::instance().enabled(level)) { \
+            Logger::instance().write(level, __VA_ARGS__);                   \
+        }                                                                   \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// 一条日志的二进制记录: 格式串指针 + 类型化参数，字符串参数复制到记录内
+// 格式串必须是字符串字面量，由后台线程在写出时才格式化
+struct LogRecord {
+    static constexpr int kMaxArgs = 12;
+    static constexpr size_t kTextBytes = 104;
+
+    enum ArgType : uint8_t { Int, Uint, Double, Bool, Text };
+
+    struct Arg {
+        ArgType type;
+        uint8_t length;     // Text: 字节数
+        uint16_t offset;    // Text: 在text中的偏移
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+        };
+    };
+
+    int64_t time_ns;
+    const char* format;
+    uint32_t thread;
+    uint8_t level;
+    uint8_t argc;
+    uint16_t text_used;
+    Arg args[kMaxArgs];
+    char text[kTextBytes];
+};
+
+// 异步日志
+// - 生产者把记录放入无锁环形队列(有界MPMC，每个槽位带序号)，不格式化、不加锁、没有系统调用
+// - 后台线程取出记录、格式化并批量write，空闲时逐步延长休眠
+// - 队列满时丢弃新日志并计数，不阻塞请求路径
+class Logger {
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        shutdown();
+    }
+
+    bool enabled(int level) const {
+        return level >= min_level.load(std::memory_order_relaxed);
+    }
+
+    // 运行时级别，只能比LOG_MIN_LEVEL更严格
+    void setLevel(int level) {
+        min_level.store(level, std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void write(int level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "日志参数过多");
+        size_t pos;
+        Cell* cell = claim(pos);
+        if (!cell) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        LogRecord& record = cell->record;
+        record.time_ns = nowNanos();
+        record.format = format;
+        record.thread = threadId();
+        record.level = static_cast<uint8_t>(level);
+        record.argc = 0;
+        record.text_used = 0;
+        int expand[] = {0, (put(record, args), 0)...};
+        (void)expand;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // 写出队列中剩余的日志并停止后台线程，之后的日志直接丢弃
+    void shutdown() {
+        if (stopping.exchange(true)) {
+            return;
+        }
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t kCapacity = 8192;   // 2的幂
+    static constexpr size_t kFlushBytes = 64 * 1024;
+    static constexpr int kMaxIdleSleepMs = 50;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) size_t dequeue_pos;             // 只由后台线程访问
+    std::atomic<int> min_level;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> stopping;
+    int fd;
+    std::thread writer;
+
+    Logger()
+        : cells(new Cell[kCapacity]), enqueue_pos(0), dequeue_pos(0),
+          min_level(LOG_MIN_LEVEL), dropped(0), stopping(false), fd(STDOUT_FILENO) {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer = std::thread([this]() { run(); });
+    }
+
+    // 占用一个槽位，队列满时返回空
+    Cell* claim(size_t& pos) {
+        if (stopping.load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & (kCapacity - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            }
+            else if (diff < 0) {
+                return nullptr;
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <typename T>
+    static void put(LogRecord& record, const T& value) {
+        if (record.argc >= LogRecord::kMaxArgs) {
+            return;
+        }
+        LogRecord::Arg& arg = record.args[record.argc++];
+        if constexpr (std::is_same<T, bool>::value) {
+            arg.type = LogRecord::Bool;
+            arg.u = value ? 1 : 0;
+        }
+        else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            arg.type = LogRecord::Int;
+            arg.i = value;
+        }
+        else if constexpr (std::is_integral<T>::value) {
+            arg.type = LogRecord::Uint;
+            arg.u = value;
+        }
+        else if constexpr (std::is_floating_point<T>::value) {
+            arg.type = LogRecord::Double;
+            arg.d = value;
+        }
+        else {
+            // 字符串: 复制到记录内，超出部分截断
+            std::string_view text(value);
+            size_t room = LogRecord::kTextBytes - record.text_used;
+            size_t length = std::min<size_t>({text.size(), room, 255});
+            arg.type = LogRecord::Text;
+            arg.offset = record.text_used;
+            arg.length = static_cast<uint8_t>(length);
+            memcpy(record.text + record.text_used, text.data(), length);
+            record.text_used += static_cast<uint16_t>(length);
+        }
+    }
+
+    static int64_t nowNanos() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+    }
+
+    static uint32_t threadId() {
+        static std::atomic<uint32_t> next_id(1);
+        thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    void run() {
+        std::string out;
+        out.reserve(kFlushBytes * 2);
+        int idle_ms = 0;
+        uint64_t reported_drops = 0;
+        while (true) {
+            bool done = stopping.load(std::memory_order_acquire);
+            size_t drained = 0;
+            Cell* cell;
+            while ((cell = front()) != nullptr) {
+                format(cell->record, out);
+                cell->sequence.store(dequeue_pos + kCapacity, std::memory_order_release);
+                ++dequeue_pos;
+                ++drained;
+                if (out.size() >= kFlushBytes) {
+                    flush(out);
+                }
+            }
+
+            uint64_t drops = dropped.load(std::memory_order_relaxed);
+            if (drops != reported_drops) {
+                out += "日志队列已满，丢弃 " + std::to_string(drops - reported_drops) + " 条日志\n";
+                reported_drops = drops;
+            }
+            flush(out);
+
+            if (done) {
+                return;
+            }
+            idle_ms = drained > 0 ? 0 : std::min(kMaxIdleSleepMs, idle_ms + 1);
+            if (idle_ms > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+            }
+        }
+    }
+
+    // 队首记录已写完时返回它的槽位
+    Cell* front() {
+        Cell* cell = &cells[dequeue_pos & (kCapacity - 1)];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        return seq == dequeue_pos + 1 ? cell : nullptr;
+    }
+
+    static void format(const LogRecord& record, std::string& out) {
+        static const char* const names[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+        time_t seconds = static_cast<time_t>(record.time_ns / 1000000000LL);
+        tm tm_buf;
+        localtime_r(&seconds, &tm_buf);
+        char prefix[64];
+        size_t n = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        snprintf(prefix + n, sizeof(prefix) - n, ".%06lld %s [%u] ",
+                 static_cast<long long>(record.time_ns % 1000000000LL / 1000),
+                 names[std::min<int>(record.level, 3)], record.thread);
+        out += prefix;
+
+        int next = 0;
+        for (const char* p = record.format; *p; ++p) {
+            if (p[0] == '{' && p[1] == '}' && next < record.argc) {
+                appendArg(record, record.args[next++], out);
+                ++p;
+            }
+            else {
+                out += *p;
+            }
+        }
+        out += '\n';
+    }
+
+    static void appendArg(const LogRecord& record, const LogRecord::Arg& arg, std::string& out) {
+        char buf[32];
+        switch (arg.type) {
+        case LogRecord::Int:
+            out += std::to_string(arg.i);
+            break;
+        case LogRecord::Uint:
+            out += std::to_string(arg.u);
+            break;
+        case LogRecord::Double:
+            snprintf(buf, sizeof(buf), "%.3f", arg.d);
+            out += buf;
+            break;
+        case LogRecord::Bool:
+            out += arg.u ? "true" : "false";
+            break;
+        case LogRecord::Text:
+            out.append(record.text + arg.offset, arg.length);
+            break;
+        }
+    }
+
+    void flush(std::string& out) {
+        size_t written = 0;
+        while (written < out.size()) {
+            ssize_t n = ::write(fd, out.data() + written, out.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        out.clear();
+    }
+};
+
+#endif // LOGGER_H
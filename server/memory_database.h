@@ -0,0 +1,338 @@
+#ifndef MEMORY_DATABASE_H
+#define MEMORY_DATABASE_H
+
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "database.h"
+
+// 内存存储后端
+// - 不需要MySQL实例，用于本机测试、压测和CI；进程退出后数据丢失
+// - seed_users大于0时按固定种子生成用户和成绩，参数相同则每次启动的数据完全相同
+// - 合并规则、排序和分页游标与MySQL后端一致
+// - LogDatabase(log_database.h)在此基础上增加日志和快照持久化
+class MemoryDatabase : public Database {
+public:
+    explicit MemoryDatabase(int seed_users = 0, uint32_t seed = 20240101) : next_row_id(1) {
+        if (seed_users > 0) {
+            populate(seed_users, seed);
+        }
+    }
+
+    bool registerUser(const std::string& username, const std::string& password,
+                      const std::string& nickname, int& user_id) override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return registerLocked(username, password, nickname, user_id);
+    }
+
+    bool loginUser(const std::string& username, const std::string& password,
+                   int& user_id, std::string& nickname) override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return loginLocked(username, password, time(nullptr), user_id, nickname);
+    }
+
+    int writeLevelRankings(JsonFrameWriter& out, int limit = 50, const RankingCursor* after = nullptr,
+                           std::string* next_cursor = nullptr) override {
+        return writePage(out, RankingType::Level, 0, false, limit, after, next_cursor);
+    }
+
+    int writeTimeRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                          const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) override {
+        return writePage(out, RankingType::Time, grid_size, used_undo, limit, after, next_cursor);
+    }
+
+    int writeStepRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                          const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) override {
+        return writePage(out, RankingType::Step, grid_size, used_undo, limit, after, next_cursor);
+    }
+
+    bool loadRankings(RankingType type, const std::function<void(const RankingEntry&)>& sink) override {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& item : tables[static_cast<int>(type)]) {
+            sink(toEntry(item.second));
+        }
+        return true;
+    }
+
+    // 与MySQL的外键约束一致: 任一条成绩的用户不存在时整批拒绝
+    bool submitGameResults(const std::vector<GameResult>& results) override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (const GameResult& result : results) {
+            if (!hasUser(result.user_id)) {
+                return false;
+            }
+        }
+        for (const GameResult& result : results) {
+            applyLocked(result);
+        }
+        return true;
+    }
+
+    bool submitGameResult(int user_id, const std::string& game_type, int grid_size,
+                          int max_level, int time_seconds, int step_count, bool used_undo,
+                          int* row_id = nullptr) override {
+        GameResult result;
+        if (!parseRankingType(game_type, result.type)) {
+            return false;
+        }
+        result.user_id = user_id;
+        result.time = time(nullptr);
+        if (result.type == RankingType::Level) {
+            result.score = max_level;
+        }
+        else {
+            result.grid_size = grid_size;
+            result.score = result.type == RankingType::Time ? time_seconds : step_count;
+            result.used_undo = used_undo;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!hasUser(user_id)) {
+            return false;
+        }
+        int id = applyLocked(result);
+        if (row_id) {
+            *row_id = id;
+        }
+        return true;
+    }
+
+    bool saveSessionRevocation(int user_id, int64_t revoked_before_ms) override {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!hasUser(user_id)) {
+            return false;
+        }
+        revokeLocked(user_id, revoked_before_ms);
+        return true;
+    }
+
+    bool loadSessionRevocations(int64_t since_ms, const std::function<void(int, int64_t)>& sink) override {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (const auto& item : session_revocations) {
+            if (item.second > since_ms) {
+                sink(item.first, item.second);
+            }
+        }
+        return true;
+    }
+
+protected:
+    struct User {
+        int id;
+        std::string username;
+        std::string password;
+        std::string nickname;
+        std::time_t last_login;
+    };
+
+    // 排行榜表中的一行，time_key用于排序和游标比较
+    struct Row {
+        int id;
+        int user_id;
+        int grid_size;
+        int score;
+        bool used_undo;
+        std::string time;
+        int64_t time_key;
+    };
+
+    // 与数据库唯一键一致: (user_id, grid_size, used_undo)，关卡表只有user_id
+    using RowKey = std::tuple<int, int, bool>;
+
+    mutable std::shared_mutex mutex;
+    std::vector<User> users;                        // 第i个用户的id为i+1
+    std::unordered_map<std::string, int> user_ids;  // username -> id
+    std::map<RowKey, Row> tables[3];                // 按RankingType索引
+    std::unordered_map<int, int64_t> session_revocations;   // user_id -> 会话吊销时间(毫秒)
+    int next_row_id;
+
+    bool hasUser(int user_id) const {
+        return user_id >= 1 && user_id <= static_cast<int>(users.size());
+    }
+
+    bool registerLocked(const std::string& username, const std::string& password,
+                        const std::string& nickname, int& user_id) {
+        if (user_ids.count(username) > 0) {
+            return false;
+        }
+        user_id = static_cast<int>(users.size()) + 1;
+        users.push_back(User{user_id, username, password, nickname, 0});
+        user_ids.emplace(username, user_id);
+        return true;
+    }
+
+    bool loginLocked(const std::string& username, const std::string& password, std::time_t now,
+                     int& user_id, std::string& nickname) {
+        auto it = user_ids.find(username);
+        if (it == user_ids.end()) {
+            return false;
+        }
+        User& user = users[it->second - 1];
+        if (user.password != password) {
+            return false;
+        }
+        user.last_login = now;
+        user_id = user.id;
+        nickname = user.nickname;
+        return true;
+    }
+
+    // 只保留较晚的吊销时间，与MySQL的GREATEST一致；返回是否更新
+    bool revokeLocked(int user_id, int64_t revoked_before_ms) {
+        int64_t& current = session_revocations[user_id];
+        if (revoked_before_ms <= current) {
+            return false;
+        }
+        current = revoked_before_ms;
+        return true;
+    }
+
+    // 按upsert规则合并一条成绩，返回行id
+    int applyLocked(const GameResult& result) {
+        bool level = result.type == RankingType::Level;
+        RowKey key(result.user_id, level ? 0 : result.grid_size, level ? false : result.used_undo);
+        std::map<RowKey, Row>& table = tables[static_cast<int>(result.type)];
+
+        auto found = table.find(key);
+        if (found == table.end()) {
+            Row row{next_row_id++, result.user_id, std::get<1>(key), result.score, std::get<2>(key), "", 0};
+            setTime(row, result.time);
+            table.emplace(key, row);
+            return row.id;
+        }
+
+        Row& row = found->second;
+        if (level) {
+            row.score = std::max(row.score, result.score);
+            setTime(row, result.time);
+        }
+        else if (result.score < row.score) {
+            row.score = result.score;
+            setTime(row, result.time);
+        }
+        return row.id;
+    }
+
+    static void setTime(Row& row, std::time_t t) {
+        row.time = formatRankingTime(t);
+        row.time_key = rankingTimeKey(row.time);
+    }
+
+    RankingEntry toEntry(const Row& row) const {
+        const User& user = users[row.user_id - 1];
+        RankingEntry entry;
+        entry.id = row.id;
+        entry.user_id = row.user_id;
+        entry.username = user.username;
+        entry.nickname = user.nickname;
+        entry.grid_size = row.grid_size;
+        entry.score = row.score;
+        entry.used_undo = row.used_undo;
+        entry.time = row.time;
+        return entry;
+    }
+
+    // 排序键与SQL的ORDER BY一致，关卡分数取负以统一升序
+    static std::tuple<int, int64_t, int> sortKey(RankingType type, int score, int64_t time_key, int id) {
+        return std::make_tuple(type == RankingType::Level ? -score : score, time_key, id);
+    }
+
+    int writePage(JsonFrameWriter& out, RankingType type, int grid_size, bool used_undo, int limit,
+                  const RankingCursor* after, std::string* next_cursor) const {
+        if (next_cursor) next_cursor->clear();
+        JsonFrameWriter::ArrayScope array(out);
+        if (limit <= 0) return 0;
+
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::vector<const Row*> rows;
+        for (const auto& item : tables[static_cast<int>(type)]) {
+            const Row& row = item.second;
+            if (type == RankingType::Level || (row.grid_size == grid_size && row.used_undo == used_undo)) {
+                rows.push_back(&row);
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [type](const Row* a, const Row* b) {
+            return sortKey(type, a->score, a->time_key, a->id) < sortKey(type, b->score, b->time_key, b->id);
+        });
+
+        auto begin = rows.begin();
+        if (after) {
+            auto bound = sortKey(type, after->score, after->time_key, after->id);
+            begin = std::upper_bound(rows.begin(), rows.end(), bound,
+                [type](const std::tuple<int, int64_t, int>& key, const Row* row) {
+                    return key < sortKey(type, row->score, row->time_key, row->id);
+                });
+        }
+
+        int count = 0;
+        for (auto it = begin; it != rows.end(); ++it) {
+            if (count == limit) {
+                if (next_cursor) {
+                    const Row& last = *it[-1];
+                    RankingCursor cursor;
+                    cursor.score = last.score;
+                    cursor.time_key = last.time_key;
+                    cursor.id = last.id;
+                    cursor.user_id = last.user_id;
+                    *next_cursor = cursor.encode();
+                }
+                break;
+            }
+            const Row& row = **it;
+            const User& user = users[row.user_id - 1];
+            writeRankingRow(out, type, row.id, row.user_id, user.username, user.nickname,
+                            row.grid_size, row.score, row.used_undo, row.time);
+            ++count;
+        }
+        return count;
+    }
+
+    // 确定性的测试数据: 用户player_1..player_N，密码password；每人一条关卡成绩，
+    // 以及随机若干(grid_size, used_undo)组合的时间和步数成绩，提交时间分布在2024年内
+    void populate(int count, uint32_t seed) {
+        // 直接取mt19937的输出再取模，不使用各标准库实现不同的分布类，保证跨平台结果一致
+        std::mt19937 rng(seed);
+        const std::time_t base = 1704038400;    // 2024-01-01 00:00:00 UTC+8
+        for (int i = 1; i <= count; ++i) {
+            int user_id = 0;
+            std::string name = "player_" + std::to_string(i);
+            registerLocked(name, "password", "玩家" + std::to_string(i), user_id);
+
+            GameResult result;
+            result.user_id = user_id;
+            result.type = RankingType::Level;
+            result.score = 1 + static_cast<int>(rng() % 30);
+            result.time = base + static_cast<std::time_t>(rng() % (365 * 24 * 3600));
+            applyLocked(result);
+
+            for (int grid_size = 3; grid_size <= 6; ++grid_size) {
+                for (bool used_undo : {false, true}) {
+                    if (rng() % 3 != 0) {
+                        continue;
+                    }
+                    result.grid_size = grid_size;
+                    result.used_undo = used_undo;
+                    result.type = RankingType::Time;
+                    result.score = 20 * grid_size + static_cast<int>(rng() % (60 * grid_size * grid_size));
+                    result.time = base + static_cast<std::time_t>(rng() % (365 * 24 * 3600));
+                    applyLocked(result);
+                    result.type = RankingType::Step;
+                    result.score = 10 * grid_size + static_cast<int>(rng() % (40 * grid_size * grid_size));
+                    applyLocked(result);
+                }
+            }
+        }
+    }
+};
+
+#endif // MEMORY_DATABASE_H
@@ -0,0 +1,233 @@
+#ifndef MYSQL_BINDING_H
+#define MYSQL_BINDING_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <mysql/mysql.h>
+
+#include "db_pool.h"
+
+// 预处理语句的类型化绑定
+// - 参数的MYSQL_BIND按实参类型在编译期生成: int -> LONG，int64_t -> LONGLONG，bool -> TINY，字符串 -> STRING(直接引用实参内容)
+// - 结果行是一个结构体，静态函数columns()按SELECT列的顺序返回成员指针；
+//   int/bool列直接写入成员，文本列(TextColumn)写入可增长的缓冲区，没有长度上限
+// - 每个线程每种行类型一份结果缓冲区，多次执行之间复用，容量稳定后读取结果不再分配内存
+
+// my_bool在MySQL 8.0中为bool，旧版本为char
+using BindFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+// 文本列，内容在下一次读取之前有效
+struct TextColumn {
+    static constexpr size_t kInitialCapacity = 64;
+
+    std::vector<char> buffer = std::vector<char>(kInitialCapacity);
+    unsigned long length = 0;
+    BindFlag is_null = 0;
+
+    std::string_view view() const {
+        return is_null ? std::string_view() : std::string_view(buffer.data(), length);
+    }
+};
+
+// 没有结果集的语句(INSERT/UPDATE)
+struct NoColumns {
+    static constexpr std::tuple<> columns() { return std::tuple<>(); }
+};
+
+inline void bindParam(MYSQL_BIND& bind, const int& value) {
+    bind.buffer_type = MYSQL_TYPE_LONG;
+    bind.buffer = const_cast<int*>(&value);
+}
+
+inline void bindParam(MYSQL_BIND& bind, const int64_t& value) {
+    bind.buffer_type = MYSQL_TYPE_LONGLONG;
+    bind.buffer = const_cast<int64_t*>(&value);
+}
+
+inline void bindParam(MYSQL_BIND& bind, const bool& value) {
+    bind.buffer_type = MYSQL_TYPE_TINY;
+    bind.buffer = const_cast<bool*>(&value);
+}
+
+inline void bindParam(MYSQL_BIND& bind, std::string_view value) {
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = const_cast<char*>(value.data());
+    bind.buffer_length = value.size();
+}
+
+inline void bindColumn(MYSQL_BIND& bind, int& value) {
+    bind.buffer_type = MYSQL_TYPE_LONG;
+    bind.buffer = &value;
+}
+
+inline void bindColumn(MYSQL_BIND& bind, int64_t& value) {
+    bind.buffer_type = MYSQL_TYPE_LONGLONG;
+    bind.buffer = &value;
+}
+
+inline void bindColumn(MYSQL_BIND& bind, bool& value) {
+    bind.buffer_type = MYSQL_TYPE_TINY;
+    bind.buffer = &value;
+}
+
+inline void bindColumn(MYSQL_BIND& bind, TextColumn& column) {
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = column.buffer.data();
+    bind.buffer_length = column.buffer.size();
+    bind.length = &column.length;
+    bind.is_null = &column.is_null;
+}
+
+// 一种行类型的结果缓冲区和对应的结果绑定
+template <typename Row>
+class ResultRow {
+public:
+    static constexpr size_t kColumnCount = std::tuple_size<decltype(Row::columns())>::value;
+
+    Row row;
+
+    bool bind(MYSQL_STMT* stmt) {
+        if constexpr (kColumnCount == 0) {
+            return true;
+        }
+        else {
+            bindAll(std::make_index_sequence<kColumnCount>());
+            return mysql_stmt_bind_result(stmt, binds.data()) == 0;
+        }
+    }
+
+    // 读取下一行，返回值与mysql_stmt_fetch相同
+    // 文本列超过缓冲区时扩容，只重新读取被截断的列，并把新缓冲区绑定给之后的行
+    int fetch(MYSQL_STMT* stmt) {
+        int rc = mysql_stmt_fetch(stmt);
+        if (rc != MYSQL_DATA_TRUNCATED) {
+            return rc;
+        }
+        bool grown = false;
+        if (!growAll(stmt, grown, std::make_index_sequence<kColumnCount>())) {
+            return 1;
+        }
+        if (grown && mysql_stmt_bind_result(stmt, binds.data()) != 0) {
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    std::array<MYSQL_BIND, kColumnCount> binds{};
+
+    template <size_t... I>
+    void bindAll(std::index_sequence<I...>) {
+        (bindColumn(binds[I], row.*std::get<I>(Row::columns())), ...);
+    }
+
+    template <size_t... I>
+    bool growAll(MYSQL_STMT* stmt, bool& grown, std::index_sequence<I...>) {
+        bool ok = true;
+        ((ok = ok && grow(stmt, static_cast<unsigned int>(I), row.*std::get<I>(Row::columns()), grown)), ...);
+        return ok;
+    }
+
+    template <typename T>
+    bool grow(MYSQL_STMT*, unsigned int, T&, bool&) {
+        return true;
+    }
+
+    bool grow(MYSQL_STMT* stmt, unsigned int index, TextColumn& column, bool& grown) {
+        if (column.is_null || column.length <= column.buffer.size()) {
+            return true;
+        }
+        column.buffer.resize(column.length);
+        bindColumn(binds[index], column);
+        grown = true;
+        return mysql_stmt_fetch_column(stmt, &binds[index], index, 0) == 0;
+    }
+};
+
+// 执行一次预处理语句: 构造时取得(必要时prepare)语句、绑定参数并执行，next()逐行读取到row()
+// 析构时释放结果集；同一连接上执行下一条语句前，上一个PreparedQuery应当已经析构
+// 结果缓冲区按线程复用，同一线程中同一行类型的查询不能嵌套
+template <typename Row = NoColumns>
+class PreparedQuery {
+public:
+    template <typename... Params>
+    PreparedQuery(MySQLConnectionPool::Handle& conn, size_t id, const std::string& sql, const Params&... params)
+        : conn(conn), stmt(conn.statement(id, sql)), result(threadResult()), ok(false) {
+        if (!stmt) {
+            return;
+        }
+        if (!bindParams(params...)) {
+            return;
+        }
+        if (mysql_stmt_execute(stmt) != 0) {
+            conn.noteError(mysql_stmt_errno(stmt));
+            return;
+        }
+        ok = result.bind(stmt);
+    }
+
+    ~PreparedQuery() {
+        if (stmt) {
+            mysql_stmt_free_result(stmt);
+        }
+    }
+
+    PreparedQuery(const PreparedQuery&) = delete;
+    PreparedQuery& operator=(const PreparedQuery&) = delete;
+
+    // 语句执行成功
+    explicit operator bool() const { return ok; }
+
+    // 读取下一行，没有更多数据或出错时返回false
+    bool next() {
+        if (!ok) {
+            return false;
+        }
+        int rc = result.fetch(stmt);
+        if (rc == 0) {
+            return true;
+        }
+        if (rc != MYSQL_NO_DATA) {
+            conn.noteError(mysql_stmt_errno(stmt));
+            ok = false;
+        }
+        return false;
+    }
+
+    const Row& row() const { return result.row; }
+
+    uint64_t insertId() const { return mysql_stmt_insert_id(stmt); }
+
+private:
+    MySQLConnectionPool::Handle& conn;
+    MYSQL_STMT* stmt;
+    ResultRow<Row>& result;
+    bool ok;
+
+    static ResultRow<Row>& threadResult() {
+        thread_local ResultRow<Row> result;
+        return result;
+    }
+
+    template <typename... Params>
+    bool bindParams(const Params&... params) {
+        if constexpr (sizeof...(Params) == 0) {
+            return true;
+        }
+        else {
+            std::array<MYSQL_BIND, sizeof...(Params)> binds{};
+            size_t i = 0;
+            (bindParam(binds[i++], params), ...);
+            return mysql_stmt_bind_param(stmt, binds.data()) == 0;
+        }
+    }
+};
+
+#endif // MYSQL_BINDING_H
@@ -0,0 +1,463 @@
+#ifndef MYSQL_DATABASE_H
+#define MYSQL_DATABASE_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mysql/mysql.h>
+
+#include "database.h"
+#include "server_config.h"
+#include "db_pool.h"
+#include "mysql_binding.h"
+#include "leaderboard.h"
+#include "logger.h"
+#include "user_cache.h"
+
+// MySQL存储后端
+// 每次操作从连接池借出一个连接，多个工作线程可以并发查询
+// 所有预处理语句通过PreparedQuery(mysql_binding.h)绑定参数和读取结果
+class MySQLDatabase : public Database {
+private:
+    MySQLConnectionPool pool;
+    UserCache user_cache;
+    LastLoginBuffer last_logins;
+    std::mutex flush_mutex;         // 同一时间只有一个线程写最后登录时间
+    uint64_t flushed_logins = 0;    // 以下两项受flush_mutex保护
+    uint64_t failed_flushes = 0;
+    
+    static constexpr size_t kLastLoginBatch = 500;  // 每条UPDATE最多更新的用户数
+    
+    // 预处理语句缓存中的语句编号
+    enum StatementId {
+        STMT_REGISTER_USER,
+        STMT_LOGIN_USER,
+        STMT_LEVEL_RANKINGS,
+        STMT_TIME_RANKINGS,
+        STMT_STEP_RANKINGS,
+        STMT_LOAD_LEVEL,
+        STMT_LOAD_TIME,
+        STMT_LOAD_STEP,
+        STMT_SUBMIT_LEVEL,
+        STMT_SUBMIT_TIME,
+        STMT_SUBMIT_STEP,
+        STMT_SAVE_REVOCATION,
+        STMT_LOAD_REVOCATIONS
+    };
+    
+    // SELECT id, nickname
+    struct UserRow {
+        int id = 0;
+        TextColumn nickname;
+        
+        static constexpr auto columns() {
+            return std::make_tuple(&UserRow::id, &UserRow::nickname);
+        }
+    };
+    
+    // SELECT user_id, revoked_before
+    struct RevocationRow {
+        int user_id = 0;
+        int64_t revoked_before = 0;
+        
+        static constexpr auto columns() {
+            return std::make_tuple(&RevocationRow::user_id, &RevocationRow::revoked_before);
+        }
+    };
+    
+    // 三种排行榜共用的列: id, user_id, username, nickname, grid_size, 成绩, used_undo, 时间
+    // 关卡排行榜没有grid_size和used_undo，查询中以常量0补齐
+    struct RankingRow {
+        int id = 0;
+        int user_id = 0;
+        TextColumn username;
+        TextColumn nickname;
+        int grid_size = 0;
+        int score = 0;
+        bool used_undo = false;
+        TextColumn time;
+        
+        static constexpr auto columns() {
+            return std::make_tuple(&RankingRow::id, &RankingRow::user_id, &RankingRow::username,
+                                   &RankingRow::nickname, &RankingRow::grid_size, &RankingRow::score,
+                                   &RankingRow::used_undo, &RankingRow::time);
+        }
+    };
+    
+    // keyset分页的绑定参数: (score, score, time, time, id, limit)
+    // 第一页使用排在所有行之前的哨兵分数，时间和id条件不起作用
+    struct KeysetParams {
+        int score;
+        char time_buf[32];
+        int time_len;
+        int id;
+        int fetch_limit;   // 多取一行，用来判断是否还有下一页
+        
+        KeysetParams(const RankingCursor* after, int first_page_score, int limit) {
+            score = after ? after->score : first_page_score;
+            int len = after ? after->formatTime(time_buf, sizeof(time_buf))
+                            : snprintf(time_buf, sizeof(time_buf), "1000-01-01 00:00:00");
+            time_len = std::max(0, std::min(len, static_cast<int>(sizeof(time_buf)) - 1));
+            id = after ? after->id : 0;
+            fetch_limit = limit < INT_MAX ? limit + 1 : limit;
+        }
+        
+        std::string_view time() const { return std::string_view(time_buf, time_len); }
+    };
+    
+    // 一页排行榜作为JSON数组写入out，每行直接从结果缓冲区写出
+    // filter为keyset条件之前的绑定参数(grid_size, used_undo)
+    template <typename... Filter>
+    int writeRankingPage(JsonFrameWriter& out, RankingType type, StatementId id, const std::string& query,
+                         int first_page_score, int limit, const RankingCursor* after,
+                         std::string* next_cursor, const Filter&... filter) {
+        if (next_cursor) next_cursor->clear();
+        JsonFrameWriter::ArrayScope array(out);
+        if (limit <= 0) return 0;
+        
+        auto conn = pool.acquire();
+        if (!conn) return -1;
+        
+        KeysetParams keyset(after, first_page_score, limit);
+        PreparedQuery<RankingRow> rows(conn, id, query, filter..., keyset.score, keyset.score,
+                                       keyset.time(), keyset.time(), keyset.id, keyset.fetch_limit);
+        
+        int count = 0;
+        RankingCursor last;
+        bool has_more = false;
+        while (rows.next()) {
+            if (count == limit) {
+                has_more = true;
+                break;
+            }
+            const RankingRow& row = rows.row();
+            writeRankingRow(out, type, row.id, row.user_id, row.username.view(), row.nickname.view(),
+                            row.grid_size, row.score, row.used_undo, row.time.view());
+            ++count;
+            
+            last.score = row.score;
+            last.time_key = rankingTimeKey(row.time.view());
+            last.id = row.id;
+            last.user_id = row.user_id;
+        }
+        if (!rows) return -1;
+        
+        if (has_more && next_cursor) {
+            *next_cursor = last.encode();
+        }
+        return count;
+    }
+    
+public:
+    MySQLDatabase(const ServerConfig& cfg)
+        : pool(cfg), user_cache(cfg.user_cache_size, std::chrono::seconds(cfg.user_cache_ttl_seconds)) {}
+    
+    ~MySQLDatabase() override {
+        flushPendingWrites();
+    }
+    
+    // 连接池统计(借出等待时间等)
+    DBPoolStats getPoolStats() override { return pool.getStats(); }
+    
+    // 对空闲连接做健康检查
+    void healthCheck() override { pool.healthCheck(); }
+    
+    UserCacheStats getUserCacheStats() override {
+        UserCacheStats stats = user_cache.getStats();
+        stats.pending_logins = last_logins.size();
+        std::lock_guard<std::mutex> lock(flush_mutex);
+        stats.flushed_logins = flushed_logins;
+        stats.failed_flushes = failed_flushes;
+        return stats;
+    }
+    
+    // 把攒下的最后登录时间批量写入，每kLastLoginBatch个用户一条UPDATE
+    // 写入失败的记录放回缓冲区，下次重试
+    void flushPendingWrites() override {
+        std::lock_guard<std::mutex> lock(flush_mutex);
+        auto logins = last_logins.take();
+        if (logins.empty()) {
+            return;
+        }
+        
+        auto conn = pool.acquire();
+        if (!conn) {
+            last_logins.restore(logins.begin(), logins.end());
+            ++failed_flushes;
+            return;
+        }
+        MYSQL* mysql = conn.get();
+        
+        std::string sql;
+        for (size_t begin = 0; begin < logins.size(); begin += kLastLoginBatch) {
+            size_t end = std::min(logins.size(), begin + kLastLoginBatch);
+            std::string ids;
+            sql = "UPDATE users SET last_login_time = CASE id";
+            for (size_t i = begin; i < end; ++i) {
+                std::string id = std::to_string(logins[i].first);
+                sql += " WHEN " + id + " THEN FROM_UNIXTIME(" +
+                       std::to_string(static_cast<long long>(logins[i].second)) + ")";
+                ids += (ids.empty() ? "" : ",") + id;
+            }
+            sql += " END WHERE id IN (" + ids + ")";
+            
+            if (mysql_real_query(mysql, sql.c_str(), sql.length()) != 0) {
+                conn.noteError(mysql_errno(mysql));
+                LOG_WARN("写入最后登录时间失败: {}，{} 条记录稍后重试", mysql_error(mysql), logins.size() - begin);
+                last_logins.restore(logins.begin() + begin, logins.end());
+                ++failed_flushes;
+                return;
+            }
+            flushed_logins += end - begin;
+        }
+    }
+    
+    // 会话吊销写入session_revocations，同一用户保留较晚的时间
+    bool saveSessionRevocation(int user_id, int64_t revoked_before_ms) override {
+        static const std::string query = "INSERT INTO session_revocations (user_id, revoked_before) VALUES (?, ?) "
+                                        "ON DUPLICATE KEY UPDATE revoked_before = GREATEST(revoked_before, VALUES(revoked_before))";
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        
+        PreparedQuery<> upsert(conn, STMT_SAVE_REVOCATION, query, user_id, revoked_before_ms);
+        return static_cast<bool>(upsert);
+    }
+    
+    // 读取较新的吊销记录，走idx_revoked_before索引
+    bool loadSessionRevocations(int64_t since_ms, const std::function<void(int, int64_t)>& sink) override {
+        static const std::string query = "SELECT user_id, revoked_before FROM session_revocations WHERE revoked_before > ?";
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        
+        PreparedQuery<RevocationRow> rows(conn, STMT_LOAD_REVOCATIONS, query, since_ms);
+        while (rows.next()) {
+            sink(rows.row().user_id, rows.row().revoked_before);
+        }
+        return static_cast<bool>(rows);
+    }
+    
+    // 用户注册
+    bool registerUser(const std::string& username, const std::string& password, 
+                     const std::string& nickname, int& user_id) override {
+        static const std::string query = "INSERT INTO users (username, password, nickname) VALUES (?, ?, ?)";
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        
+        PreparedQuery<> insert(conn, STMT_REGISTER_USER, query, username, password, nickname);
+        if (!insert) return false;
+        
+        user_id = static_cast<int>(insert.insertId());
+        // 同名用户可能在数据库中被删除后重新注册，旧的缓存记录不再有效
+        user_cache.invalidate(username);
+        return true;
+    }
+    
+    // 用户登录
+    // 缓存命中时不访问数据库；最后登录时间只记入内存，由flushPendingWrites批量写入，请求路径上没有写操作
+    bool loginUser(const std::string& username, const std::string& password,
+                  int& user_id, std::string& nickname) override {
+        if (!user_cache.verify(username, password, user_id, nickname)) {
+            static const std::string query = "SELECT id, nickname FROM users WHERE username = ? AND password = ?";
+            
+            auto conn = pool.acquire();
+            if (!conn) return false;
+            
+            PreparedQuery<UserRow> user(conn, STMT_LOGIN_USER, query, username, password);
+            if (!user.next()) return false;
+            user_id = user.row().id;
+            nickname.assign(user.row().nickname.view());
+            user_cache.insert(username, password, user_id, nickname);
+        }
+        
+        last_logins.record(user_id, time(nullptr));
+        return true;
+    }
+    
+    // 获取关卡排行榜，after为空时从第一名开始；还有下一页时next_cursor返回游标
+    int writeLevelRankings(JsonFrameWriter& out, int limit = 50, const RankingCursor* after = nullptr,
+                           std::string* next_cursor = nullptr) override {
+        static const std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, 0, r.max_level, 0, r.update_time "
+                                        "FROM level_rankings r JOIN users u ON r.user_id = u.id "
+                                        "WHERE r.max_level < ? OR (r.max_level = ? AND "
+                                        "(r.update_time > ? OR (r.update_time = ? AND r.id > ?))) "
+                                        "ORDER BY r.max_level DESC, r.update_time ASC, r.id ASC LIMIT ?";
+        
+        return writeRankingPage(out, RankingType::Level, STMT_LEVEL_RANKINGS, query, INT_MAX, limit, after, next_cursor);
+    }
+    
+    // 获取时间排行榜
+    int writeTimeRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                          const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) override {
+        static const std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.time_seconds, r.used_undo, r.create_time "
+                                        "FROM time_rankings r JOIN users u ON r.user_id = u.id "
+                                        "WHERE r.grid_size = ? AND r.used_undo = ? AND (r.time_seconds > ? OR (r.time_seconds = ? AND "
+                                        "(r.create_time > ? OR (r.create_time = ? AND r.id > ?)))) "
+                                        "ORDER BY r.time_seconds ASC, r.create_time ASC, r.id ASC LIMIT ?";
+        
+        return writeRankingPage(out, RankingType::Time, STMT_TIME_RANKINGS, query, INT_MIN, limit, after, next_cursor,
+                                grid_size, used_undo);
+    }
+    
+    // 获取步数排行榜
+    int writeStepRankings(JsonFrameWriter& out, int grid_size, bool used_undo, int limit = 50,
+                          const RankingCursor* after = nullptr, std::string* next_cursor = nullptr) override {
+        static const std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.step_count, r.used_undo, r.create_time "
+                                        "FROM step_rankings r JOIN users u ON r.user_id = u.id "
+                                        "WHERE r.grid_size = ? AND r.used_undo = ? AND (r.step_count > ? OR (r.step_count = ? AND "
+                                        "(r.create_time > ? OR (r.create_time = ? AND r.id > ?)))) "
+                                        "ORDER BY r.step_count ASC, r.create_time ASC, r.id ASC LIMIT ?";
+        
+        return writeRankingPage(out, RankingType::Step, STMT_STEP_RANKINGS, query, INT_MIN, limit, after, next_cursor,
+                                grid_size, used_undo);
+    }
+    
+    // 读取整张排行榜表，逐行交给sink，用于启动时加载内存排行榜
+    // 不调用mysql_stmt_store_result，逐行从服务器读取，不把整张表缓存在客户端
+    bool loadRankings(RankingType type, const std::function<void(const RankingEntry&)>& sink) override {
+        static const std::string queries[] = {
+            "SELECT r.id, r.user_id, u.username, u.nickname, 0, r.max_level, 0, r.update_time "
+            "FROM level_rankings r JOIN users u ON r.user_id = u.id",
+            "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.time_seconds, r.used_undo, r.create_time "
+            "FROM time_rankings r JOIN users u ON r.user_id = u.id",
+            "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.step_count, r.used_undo, r.create_time "
+            "FROM step_rankings r JOIN users u ON r.user_id = u.id"
+        };
+        static const StatementId ids[] = {STMT_LOAD_LEVEL, STMT_LOAD_TIME, STMT_LOAD_STEP};
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        
+        int index = static_cast<int>(type);
+        PreparedQuery<RankingRow> rows(conn, ids[index], queries[index]);
+        if (!rows) return false;
+        
+        // 同一个entry逐行复用，字符串容量稳定后不再分配
+        RankingEntry entry;
+        while (rows.next()) {
+            const RankingRow& row = rows.row();
+            entry.id = row.id;
+            entry.user_id = row.user_id;
+            entry.username.assign(row.username.view());
+            entry.nickname.assign(row.nickname.view());
+            entry.grid_size = row.grid_size;
+            entry.score = row.score;
+            entry.used_undo = row.used_undo;
+            entry.time.assign(row.time.view());
+            sink(entry);
+        }
+        return static_cast<bool>(rows);
+    }
+    
+    // 在一个事务中批量写入成绩，每个排行榜表一条多行upsert
+    // 合并规则与submitGameResult相同，时间列使用GameResult::time而不是NOW()
+    bool submitGameResults(const std::vector<GameResult>& results) override {
+        std::string statements[3];
+        for (const GameResult& r : results) {
+            std::string& sql = statements[static_cast<int>(r.type)];
+            sql += sql.empty() ? "" : ",";
+            if (r.type == RankingType::Level) {
+                sql += "(" + std::to_string(r.user_id) + "," + std::to_string(r.score) +
+                       ",FROM_UNIXTIME(" + std::to_string(static_cast<long long>(r.time)) + "))";
+            }
+            else {
+                sql += "(" + std::to_string(r.user_id) + "," + std::to_string(r.grid_size) + "," +
+                       std::to_string(r.score) + "," + (r.used_undo ? "1" : "0") +
+                       ",FROM_UNIXTIME(" + std::to_string(static_cast<long long>(r.time)) + "))";
+            }
+        }
+        if (!statements[0].empty()) {
+            statements[0] = "INSERT INTO level_rankings (user_id, max_level, update_time) VALUES " + statements[0] +
+                            " ON DUPLICATE KEY UPDATE max_level = GREATEST(max_level, VALUES(max_level)), "
+                            "update_time = VALUES(update_time)";
+        }
+        // create_time要和更新前的成绩比较，所以必须在LEAST赋值之前
+        if (!statements[1].empty()) {
+            statements[1] = "INSERT INTO time_rankings (user_id, grid_size, time_seconds, used_undo, create_time) VALUES " +
+                            statements[1] +
+                            " ON DUPLICATE KEY UPDATE create_time = IF(VALUES(time_seconds) < time_seconds, VALUES(create_time), create_time), "
+                            "time_seconds = LEAST(time_seconds, VALUES(time_seconds))";
+        }
+        if (!statements[2].empty()) {
+            statements[2] = "INSERT INTO step_rankings (user_id, grid_size, step_count, used_undo, create_time) VALUES " +
+                            statements[2] +
+                            " ON DUPLICATE KEY UPDATE create_time = IF(VALUES(step_count) < step_count, VALUES(create_time), create_time), "
+                            "step_count = LEAST(step_count, VALUES(step_count))";
+        }
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        MYSQL* mysql = conn.get();
+        
+        // 整批只提交一次，日志刷盘次数与批次数相同
+        if (mysql_query(mysql, "START TRANSACTION") != 0) {
+            conn.noteError(mysql_errno(mysql));
+            return false;
+        }
+        for (const std::string& sql : statements) {
+            if (!sql.empty() && mysql_real_query(mysql, sql.c_str(), sql.length()) != 0) {
+                conn.noteError(mysql_errno(mysql));
+                mysql_rollback(mysql);
+                return false;
+            }
+        }
+        if (mysql_commit(mysql) != 0) {
+            conn.noteError(mysql_errno(mysql));
+            mysql_rollback(mysql);
+            return false;
+        }
+        return true;
+    }
+    
+    // 提交游戏结果，row_id返回排行榜表中对应行的id
+    bool submitGameResult(int user_id, const std::string& game_type, int grid_size, 
+                         int max_level, int time_seconds, int step_count, bool used_undo,
+                         int* row_id = nullptr) override {
+        // 更新或插入关卡排行榜
+        static const std::string level_query = "INSERT INTO level_rankings (user_id, max_level) VALUES (?, ?) "
+                                              "ON DUPLICATE KEY UPDATE id = LAST_INSERT_ID(id), max_level = GREATEST(max_level, ?), update_time = NOW()";
+        // 更新或插入时间/步数排行榜
+        // create_time要和更新前的成绩比较，所以必须在LEAST赋值之前
+        static const std::string time_query = "INSERT INTO time_rankings (user_id, grid_size, time_seconds, used_undo) VALUES (?, ?, ?, ?) "
+                                             "ON DUPLICATE KEY UPDATE id = LAST_INSERT_ID(id), create_time = IF(? < time_seconds, NOW(), create_time), time_seconds = LEAST(time_seconds, ?)";
+        static const std::string step_query = "INSERT INTO step_rankings (user_id, grid_size, step_count, used_undo) VALUES (?, ?, ?, ?) "
+                                             "ON DUPLICATE KEY UPDATE id = LAST_INSERT_ID(id), create_time = IF(? < step_count, NOW(), create_time), step_count = LEAST(step_count, ?)";
+        
+        if (game_type != "level" && game_type != "time" && game_type != "step") {
+            return false;
+        }
+        
+        auto conn = pool.acquire();
+        if (!conn) return false;
+        
+        auto finish = [row_id](const PreparedQuery<>& upsert) {
+            if (upsert && row_id) {
+                *row_id = static_cast<int>(upsert.insertId());
+            }
+            return static_cast<bool>(upsert);
+        };
+        
+        if (game_type == "level") {
+            PreparedQuery<> upsert(conn, STMT_SUBMIT_LEVEL, level_query, user_id, max_level, max_level);
+            return finish(upsert);
+        }
+        if (game_type == "time") {
+            PreparedQuery<> upsert(conn, STMT_SUBMIT_TIME, time_query, user_id, grid_size, time_seconds, used_undo,
+                                   time_seconds, time_seconds);
+            return finish(upsert);
+        }
+        PreparedQuery<> upsert(conn, STMT_SUBMIT_STEP, step_query, user_id, grid_size, step_count, used_undo,
+                               step_count, step_count);
+        return finish(upsert);
+    }
+};
+
+#endif // MYSQL_DATABASE_H
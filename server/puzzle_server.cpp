@@ -1,7 +1,10 @@
-#include <iostream>
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -10,911 +13,1371 @@
 #include <csignal>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
-#include <mysql/mysql.h>
+
+#include "server_config.h"
+#include "database_factory.h"
+#include "event_loop.h"
+#include "session_token.h"
+#include "frame_decoder.h"
+#include "json_writer.h"
+#include "request_parser.h"
+#include "logger.h"
+#include "server_metrics.h"
+#include "submit_queue.h"
+#include "uring.h"
+#include "worker_pool.h"
 
 // JSON库使用nlohmann/json
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
-// 服务器配置
-struct ServerConfig {
-    int port = 8080;
-    std::string db_host = "localhost";
-    int db_port = 3306;
-    std::string db_user = "puzzle_admin";
-    std::string db_password = "123456";
-    std::string db_name = "puzzle_game";
-    int max_connections = 100;
+// 工作线程产生的响应: 新序列化的JSON，或已经带长度头的完整帧(热门排行榜快照、流式写出的排行榜页)
+// deferred为true时工作线程不发送，响应稍后通过ReplySink投递(成绩所在批次提交后)
+struct Reply {
+    std::string payload;
+    SharedFrame frame;
+    bool deferred = false;
 };
 
-// 用户会话信息
-struct Session {
-    int user_id;
-    std::string username;
-    std::string nickname;
-    std::chrono::system_clock::time_point create_time;
-    
-    Session(int id, const std::string& uname, const std::string& nick)
-        : user_id(id), username(uname), nickname(nick),
-          create_time(std::chrono::system_clock::now()) {}
-};
+// 把响应投递回I/O线程，可以在任意线程调用
+using ReplySink = std::function<void(Reply)>;
 
-// 数据库连接类
-class Database {
+// 客户端连接类
+class ClientConnection {
 private:
-    MYSQL* mysql;
-    ServerConfig config;
+    // 待发送的一帧，written包含4字节长度头
+    // 预编码的共享帧(shared)自带长度头，直接引用发送，不复制
+    struct OutputFrame {
+        uint32_t header;
+        std::string body;
+        SharedFrame shared;
+        size_t written;
+        
+        size_t size() const { return shared ? shared->size() : sizeof(header) + body.size(); }
+    };
+    
+    int socket_fd;
+    std::string client_ip;
+    std::chrono::system_clock::time_point connect_time;
+    FrameDecoder decoder;
+    std::deque<OutputFrame> output_queue;
+    size_t queued_bytes;
+    size_t high_water_mark;
+    bool reading_paused;
+    bool write_failed;
+    std::deque<std::string> pending_requests;
+    bool request_in_flight;
+    ServerMetrics& metrics;
     
 public:
-    Database(const ServerConfig& cfg) : config(cfg) {
-        mysql = mysql_init(nullptr);
-        if (!mysql) {
-            throw std::runtime_error("MySQL初始化失败");
-        }
-        
-        if (!mysql_real_connect(mysql, config.db_host.c_str(), config.db_user.c_str(),
-                               config.db_password.c_str(), config.db_name.c_str(),
-                               config.db_port, nullptr, 0)) {
-            std::string error = mysql_error(mysql);
-            mysql_close(mysql);
-            throw std::runtime_error("数据库连接失败: " + error);
-        }
-        
-        // 设置字符集
-        mysql_set_character_set(mysql, "utf8mb4");
+    ClientConnection(int fd, const std::string& ip, ServerMetrics& metrics, size_t high_water = 1024 * 1024) 
+        : socket_fd(fd), client_ip(ip), connect_time(std::chrono::system_clock::now()),
+          queued_bytes(0), high_water_mark(high_water), reading_paused(false), write_failed(false),
+          request_in_flight(false), metrics(metrics) {
+        // 响应都是一次性写出的完整帧，关闭Nagle避免与对端延迟ACK叠加
+        int one = 1;
+        setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
     }
     
-    ~Database() {
-        if (mysql) {
-            mysql_close(mysql);
+    ~ClientConnection() {
+        if (socket_fd != -1) {
+            close(socket_fd);
         }
     }
     
-    // 用户注册
-    bool registerUser(const std::string& username, const std::string& password, 
-                     const std::string& nickname, int& user_id) {
-        std::string query = "INSERT INTO users (username, password, nickname) VALUES (?, ?, ?)";
-        
-        MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-        if (!stmt) return false;
-        
-        if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-            mysql_stmt_close(stmt);
+    int getSocket() const { return socket_fd; }
+    std::string getIp() const { return client_ip; }
+    
+    // 将一帧加入发送队列，实际写出由flushOutput()完成
+    // 同一批请求的多个响应会在一次writev中合并发出
+    bool sendData(std::string data) {
+        if (write_failed) {
             return false;
         }
         
-        MYSQL_BIND bind[3];
-        memset(bind, 0, sizeof(bind));
-        
-        bind[0].buffer_type = MYSQL_TYPE_STRING;
-        bind[0].buffer = (void*)username.c_str();
-        bind[0].buffer_length = username.length();
-        
-        bind[1].buffer_type = MYSQL_TYPE_STRING;
-        bind[1].buffer = (void*)password.c_str();
-        bind[1].buffer_length = password.length();
-        
-        bind[2].buffer_type = MYSQL_TYPE_STRING;
-        bind[2].buffer = (void*)nickname.c_str();
-        bind[2].buffer_length = nickname.length();
-        
-        if (mysql_stmt_bind_param(stmt, bind) != 0) {
-            mysql_stmt_close(stmt);
+        uint32_t length = htonl(static_cast<uint32_t>(data.size()));
+        output_queue.push_back(OutputFrame{length, std::move(data), SharedFrame(), 0});
+        return noteQueued(output_queue.back().size());
+    }
+    
+    // 发送已编码好的共享帧
+    bool sendFrame(SharedFrame frame) {
+        if (write_failed) {
             return false;
         }
         
-        if (mysql_stmt_execute(stmt) != 0) {
-            mysql_stmt_close(stmt);
-            return false;
+        output_queue.push_back(OutputFrame{0, std::string(), std::move(frame), 0});
+        return noteQueued(output_queue.back().size());
+    }
+    
+    // 用writev聚合写出发送队列，长度头和数据在同一次系统调用中发出
+    // 返回false表示连接已不可写，应当关闭
+    bool flushOutput() {
+        while (!output_queue.empty()) {
+            iovec iov[kMaxIov];
+            int iov_count = fillOutputIov(iov, kMaxIov);
+            
+            ssize_t sent = ::writev(socket_fd, iov, iov_count);
+            metrics.add(ServerCounter::IoSyscalls);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    // 内核发送缓冲区已满，等待EPOLLOUT
+                    break;
+                }
+                write_failed = true;
+                return false;
+            }
+            
+            onOutputSent(static_cast<size_t>(sent));
         }
-        
-        user_id = mysql_insert_id(mysql);
-        mysql_stmt_close(stmt);
         return true;
     }
     
-    // 用户登录
-    bool loginUser(const std::string& username, const std::string& password,
-                  int& user_id, std::string& nickname) {
-        std::string query = "SELECT id, nickname FROM users WHERE username = ? AND password = ?";
-        
-        MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-        if (!stmt) return false;
+    // 把发送队列中的帧依次填入iov，返回使用的个数
+    // iov指向队列中的数据，在onOutputSent之前不能修改已填入的帧
+    int fillOutputIov(iovec* iov, int max_iov) {
+        int iov_count = 0;
+        for (auto& frame : output_queue) {
+            if (iov_count + 2 > max_iov) {
+                break;
+            }
+            if (frame.shared) {
+                iov[iov_count].iov_base = const_cast<char*>(frame.shared->data()) + frame.written;
+                iov[iov_count].iov_len = frame.shared->size() - frame.written;
+                ++iov_count;
+            }
+            else if (frame.written < sizeof(frame.header)) {
+                iov[iov_count].iov_base = reinterpret_cast<char*>(&frame.header) + frame.written;
+                iov[iov_count].iov_len = sizeof(frame.header) - frame.written;
+                ++iov_count;
+                if (!frame.body.empty()) {
+                    iov[iov_count].iov_base = &frame.body[0];
+                    iov[iov_count].iov_len = frame.body.size();
+                    ++iov_count;
+                }
+            }
+            else {
+                size_t offset = frame.written - sizeof(frame.header);
+                iov[iov_count].iov_base = &frame.body[offset];
+                iov[iov_count].iov_len = frame.body.size() - offset;
+                ++iov_count;
+            }
+        }
+        return iov_count;
+    }
+    
+    // 内核已写出sent字节: 释放写完的帧，发送队列回落后恢复读取
+    void onOutputSent(size_t sent) {
+        metrics.add(ServerCounter::BytesSent, static_cast<uint64_t>(sent));
+        consumeOutput(sent);
+        if (reading_paused && queued_bytes <= high_water_mark / 2) {
+            reading_paused = false;
+        }
+    }
+    
+    // 发送队列积压或待处理请求过多时停止读取
+    bool canRead() const {
+        return !reading_paused && pending_requests.size() < kMaxPendingRequests;
+    }
+    bool hasPendingOutput() const { return !output_queue.empty(); }
+    
+    // 已解码、等待交给工作线程的请求
+    // 同一连接同一时间只有一个请求在处理，响应顺序与请求顺序一致
+    void enqueueRequest(std::string message) { pending_requests.push_back(std::move(message)); }
+    bool hasPendingRequest() const { return !pending_requests.empty(); }
+    std::string takeRequest() {
+        std::string message = std::move(pending_requests.front());
+        pending_requests.pop_front();
+        return message;
+    }
+    bool isRequestInFlight() const { return request_in_flight; }
+    void setRequestInFlight(bool in_flight) { request_in_flight = in_flight; }
+    
+    // 非阻塞读取一帧
+    // 返回 1: data中为一条完整消息; -1: 暂无完整消息(EAGAIN); 0: 连接断开或协议错误
+    // 半包保存在decoder中，等下一次可读事件继续解析，不会阻塞其他客户端
+    int receiveData(std::string& data) {
+        while (!decoder.hasFrame()) {
+            char chunk[16 * 1024];
+            ssize_t received = ::recv(socket_fd, chunk, sizeof(chunk), 0);
+            metrics.add(ServerCounter::IoSyscalls);
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return -1;
+                }
+                LOG_WARN("接收数据失败，连接断开: {}", strerror(errno));
+                return 0;
+            }
+            if (received == 0) {
+                onPeerClosed();
+                return 0;
+            }
+            if (!feed(chunk, static_cast<size_t>(received))) {
+                return 0;
+            }
+        }
         
-        if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-            mysql_stmt_close(stmt);
+        data = decoder.takeFrame();
+        return 1;
+    }
+    
+    // 把已收到的数据交给解帧器，超过长度限制时返回false
+    // io_uring后端由内核把数据收进缓冲区，直接调用feed和nextFrame
+    bool feed(const char* data, size_t size) {
+        metrics.add(ServerCounter::BytesReceived, static_cast<uint64_t>(size));
+        if (!decoder.feed(data, size)) {
+            LOG_WARN("数据长度超过限制，连接断开");
             return false;
         }
-        
-        MYSQL_BIND bind[2];
-        memset(bind, 0, sizeof(bind));
-        
-        bind[0].buffer_type = MYSQL_TYPE_STRING;
-        bind[0].buffer = (void*)username.c_str();
-        bind[0].buffer_length = username.length();
-        
-        bind[1].buffer_type = MYSQL_TYPE_STRING;
-        bind[1].buffer = (void*)password.c_str();
-        bind[1].buffer_length = password.length();
-        
-        if (mysql_stmt_bind_param(stmt, bind) != 0) {
-            mysql_stmt_close(stmt);
+        return true;
+    }
+    
+    // 对端已关闭，解码器中未完成的消息被丢弃
+    void onPeerClosed() {
+        if (decoder.pendingBytes() > 0) {
+            LOG_WARN("连接在消息中途关闭，丢弃半包");
+        }
+    }
+    
+    bool nextFrame(std::string& data) {
+        if (!decoder.hasFrame()) {
             return false;
         }
-        
-        if (mysql_stmt_execute(stmt) != 0) {
-            mysql_stmt_close(stmt);
+        data = decoder.takeFrame();
+        return true;
+    }
+    
+    // 消息处理完毕后归还缓冲区
+    void recycleBuffer(std::string&& data) {
+        BufferPool::instance().release(std::move(data));
+    }
+    
+    static constexpr int kMaxIov = 64;
+    
+private:
+    static constexpr size_t kMaxPendingRequests = 64;
+    
+    bool noteQueued(size_t bytes) {
+        queued_bytes += bytes;
+        // 对端读得太慢时暂停读取它的请求，直到发送队列回落
+        if (queued_bytes > high_water_mark) {
+            reading_paused = true;
+        }
+        return true;
+    }
+    
+    void consumeOutput(size_t sent) {
+        queued_bytes -= sent;
+        while (sent > 0) {
+            OutputFrame& frame = output_queue.front();
+            size_t remaining = frame.size() - frame.written;
+            if (sent < remaining) {
+                frame.written += sent;
+                return;
+            }
+            sent -= remaining;
+            if (!frame.shared) {
+                BufferPool::instance().release(std::move(frame.body));
+            }
+            output_queue.pop_front();
+        }
+    }
+};
+
+// 一个I/O线程: 自己的监听socket(SO_REUSEPORT)、事件循环和连接
+// - 内核按连接的四元组把新连接分散到各reactor的监听socket上，之后连接只在所属reactor的线程中处理，
+//   连接表不需要加锁
+// - 请求交给共享的工作线程池处理，完成后投递回所属reactor的事件循环发送
+// - 收发由子类实现: EpollReactor(就绪通知 + recv/writev)，UringReactor(io_uring完成通知)
+class Reactor {
+public:
+    using RequestHandler = std::function<Reply(const std::string& message,
+                                               std::chrono::steady_clock::time_point dispatched_at,
+                                               const ReplySink& deferred_reply)>;
+    
+    Reactor(int index, const ServerConfig& config, ServerMetrics& metrics, WorkerPool& workers,
+            RequestHandler handler)
+        : index(index), config(config), metrics(metrics), workers(workers), handler(std::move(handler)),
+          listen_fd(-1), loop(std::make_unique<EventLoop>()), connection_count(0) {}
+    
+    virtual ~Reactor() {
+        if (listen_fd != -1) {
+            close(listen_fd);
+        }
+    }
+    
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    
+    // 创建监听socket，多个reactor时设置SO_REUSEPORT，每个reactor绑定同一端口
+    virtual bool listen() {
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd == -1) {
+            LOG_ERROR("创建socket失败");
             return false;
         }
         
-        MYSQL_RES* result = mysql_stmt_result_metadata(stmt);
-        if (!result) {
-            mysql_stmt_close(stmt);
+        // 设置socket选项
+        int opt = 1;
+        if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+            (config.reactor_threads > 1 && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)) {
+            LOG_ERROR("设置socket选项失败");
             return false;
         }
         
-        MYSQL_BIND result_bind[2];
-        memset(result_bind, 0, sizeof(result_bind));
-        
-        result_bind[0].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[0].buffer = &user_id;
-        
-        char nickname_buf[256];
-        unsigned long nickname_length;
-        result_bind[1].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[1].buffer = nickname_buf;
-        result_bind[1].buffer_length = sizeof(nickname_buf);
-        result_bind[1].length = &nickname_length;
+        // 绑定地址和端口
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(config.port);
         
-        if (mysql_stmt_bind_result(stmt, result_bind) != 0) {
-            mysql_free_result(result);
-            mysql_stmt_close(stmt);
+        if (bind(listen_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+            LOG_ERROR("绑定失败");
             return false;
         }
         
-        if (mysql_stmt_fetch(stmt) != 0) {
-            mysql_free_result(result);
-            mysql_stmt_close(stmt);
+        // 开始监听
+        if (::listen(listen_fd, config.max_connections) < 0) {
+            LOG_ERROR("监听失败");
             return false;
         }
-        
-        nickname = std::string(nickname_buf, nickname_length);
-        
-        mysql_free_result(result);
-        mysql_stmt_close(stmt);
-        
-        // 更新最后登录时间
-        std::string update_query = "UPDATE users SET last_login_time = NOW() WHERE id = ?";
-        MYSQL_STMT* update_stmt = mysql_stmt_init(mysql);
-        if (update_stmt) {
-            mysql_stmt_prepare(update_stmt, update_query.c_str(), update_query.length());
-            MYSQL_BIND update_bind;
-            memset(&update_bind, 0, sizeof(update_bind));
-            update_bind.buffer_type = MYSQL_TYPE_LONG;
-            update_bind.buffer = &user_id;
-            mysql_stmt_bind_param(update_stmt, &update_bind);
-            mysql_stmt_execute(update_stmt);
-            mysql_stmt_close(update_stmt);
-        }
-        
         return true;
     }
     
-    // 获取关卡排行榜
-    json getLevelRankings(int limit = 50) {
-        std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, r.max_level, r.update_time "
-                           "FROM level_rankings r JOIN users u ON r.user_id = u.id "
-                           "ORDER BY r.max_level DESC, r.update_time ASC LIMIT ?";
-        
-        MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-        if (!stmt) return json::array();
-        
-        if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
-        }
-        
-        MYSQL_BIND bind;
-        memset(&bind, 0, sizeof(bind));
-        bind.buffer_type = MYSQL_TYPE_LONG;
-        bind.buffer = &limit;
-        
-        if (mysql_stmt_bind_param(stmt, &bind) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+    // 在新线程中运行，reactor 0由调用PuzzleGameServer::run()的线程直接运行
+    void startThread() {
+        thread = std::thread([this]() { run(); });
+    }
+    
+    void run() {
+        if (config.reactor_cpu_affinity) {
+            pinToCpu();
         }
-        
-        if (mysql_stmt_execute(stmt) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+        runLoop();
+    }
+    
+    // 可以从其他线程和信号处理函数中调用
+    void stop() {
+        loop->stop();
+    }
+    
+    void join() {
+        if (thread.joinable()) {
+            thread.join();
         }
-        
-        MYSQL_RES* result = mysql_stmt_result_metadata(stmt);
-        if (!result) {
-            mysql_stmt_close(stmt);
-            return json::array();
+    }
+    
+    // 线程停止后关闭所有连接和监听socket
+    virtual void closeAll() = 0;
+    
+    virtual const char* backendName() const = 0;
+    
+    // 定时器、跨线程任务和监控端点注册在这里；io_uring后端同样由它处理这些事件
+    EventLoop& eventLoop() { return *loop; }
+    size_t connectionCount() const { return connection_count.load(std::memory_order_relaxed); }
+    
+protected:
+    int index;
+    const ServerConfig& config;
+    ServerMetrics& metrics;
+    WorkerPool& workers;
+    RequestHandler handler;
+    int listen_fd;
+    std::unique_ptr<EventLoop> loop;
+    std::atomic<size_t> connection_count;   // 供server_stats从其他线程读取
+    std::thread thread;
+    
+    virtual void runLoop() = 0;
+    
+    // 响应已进入发送队列: 写出，背压解除(could_read由false变为true)时继续读取
+    virtual void onReplyQueued(const std::shared_ptr<ClientConnection>& client, bool could_read) = 0;
+    
+    void closeListener() {
+        if (listen_fd != -1) {
+            close(listen_fd);
+            listen_fd = -1;
         }
-        
-        json rankings = json::array();
-        
-        int id, user_id, max_level;
-        char username[256], nickname[256], update_time[256];
-        unsigned long username_len, nickname_len, update_time_len;
-        
-        MYSQL_BIND result_bind[6];
-        memset(result_bind, 0, sizeof(result_bind));
-        
-        result_bind[0].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[0].buffer = &id;
-        
-        result_bind[1].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[1].buffer = &user_id;
-        
-        result_bind[2].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[2].buffer = username;
-        result_bind[2].buffer_length = sizeof(username);
-        result_bind[2].length = &username_len;
-        
-        result_bind[3].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[3].buffer = nickname;
-        result_bind[3].buffer_length = sizeof(nickname);
-        result_bind[3].length = &nickname_len;
-        
-        result_bind[4].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[4].buffer = &max_level;
-        
-        result_bind[5].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[5].buffer = update_time;
-        result_bind[5].buffer_length = sizeof(update_time);
-        result_bind[5].length = &update_time_len;
-        
-        if (mysql_stmt_bind_result(stmt, result_bind) == 0) {
-            while (mysql_stmt_fetch(stmt) == 0) {
-                json ranking;
-                ranking["id"] = id;
-                ranking["user_id"] = user_id;
-                ranking["username"] = std::string(username, username_len);
-                ranking["nickname"] = std::string(nickname, nickname_len);
-                ranking["max_level"] = max_level;
-                ranking["update_time"] = std::string(update_time, update_time_len);
-                rankings.push_back(ranking);
+    }
+    
+    // 把连接的下一个请求交给工作线程
+    void dispatchNextRequest(const std::shared_ptr<ClientConnection>& client) {
+        while (!client->isRequestInFlight() && client->hasPendingRequest()) {
+            auto message = std::make_shared<std::string>(client->takeRequest());
+            std::weak_ptr<ClientConnection> weak_client = client;
+            auto dispatched_at = std::chrono::steady_clock::now();
+            
+            client->setRequestInFlight(true);
+            bool accepted = workers.submit([this, weak_client, message, dispatched_at]() {
+                ReplySink deliver = [this, weak_client](Reply reply) {
+                    loop->queueInLoop([this, weak_client, reply = std::move(reply)]() mutable {
+                        onRequestCompleted(weak_client, std::move(reply));
+                    });
+                };
+                Reply reply = handler(*message, dispatched_at, deliver);
+                BufferPool::instance().release(std::move(*message));
+                if (!reply.deferred) {
+                    deliver(std::move(reply));
+                }
+            });
+            
+            if (!accepted) {
+                // 工作线程队列已满，直接拒绝，继续尝试下一个请求
+                metrics.add(ServerCounter::BusyRejections);
+                client->setRequestInFlight(false);
+                client->recycleBuffer(std::move(*message));
+                json busy_response = {
+                    {"type", "error"},
+                    {"success", false},
+                    {"message", "服务器繁忙，请稍后重试"},
+                    {"error_code", "SERVER_BUSY"}
+                };
+                client->sendData(busy_response.dump());
             }
         }
-        
-        mysql_free_result(result);
-        mysql_stmt_close(stmt);
-        
-        return rankings;
     }
     
-    // 获取时间排行榜
-    json getTimeRankings(int grid_size, bool used_undo, int limit = 50) {
-        std::cout << "getTimeRankings called with grid_size=" << grid_size << ", used_undo=" << used_undo << ", limit=" << limit << std::endl;
-        
-        std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.time_seconds, r.used_undo, r.create_time "
-                           "FROM time_rankings r JOIN users u ON r.user_id = u.id "
-                           "WHERE r.grid_size = ? AND r.used_undo = ? "
-                           "ORDER BY r.time_seconds ASC, r.create_time ASC LIMIT ?";
-        
-        MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-        if (!stmt) {
-            std::cout << "Failed to initialize statement" << std::endl;
-            return json::array();
+private:
+    void pinToCpu() {
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            LOG_WARN("I/O线程{}绑定CPU失败: {}", index, strerror(err));
         }
-        
-        if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-            std::cout << "Failed to prepare statement: " << mysql_stmt_error(stmt) << std::endl;
-            mysql_stmt_close(stmt);
-            return json::array();
+    }
+    
+    // 在I/O线程中执行：发送响应并分发该连接的下一个请求
+    void onRequestCompleted(const std::weak_ptr<ClientConnection>& weak_client, Reply reply) {
+        auto client = weak_client.lock();
+        if (!client) {
+            // 处理期间连接已关闭
+            return;
         }
         
-        MYSQL_BIND bind[3];
-        memset(bind, 0, sizeof(bind));
-        
-        bind[0].buffer_type = MYSQL_TYPE_LONG;
-        bind[0].buffer = &grid_size;
-        
-        bind[1].buffer_type = MYSQL_TYPE_TINY;
-        bind[1].buffer = &used_undo;
-        
-        bind[2].buffer_type = MYSQL_TYPE_LONG;
-        bind[2].buffer = &limit;
-        
-        if (mysql_stmt_bind_param(stmt, bind) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+        bool could_read = client->canRead();
+        client->setRequestInFlight(false);
+        if (reply.frame) {
+            client->sendFrame(std::move(reply.frame));
         }
-        
-        if (mysql_stmt_execute(stmt) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+        else {
+            client->sendData(std::move(reply.payload));
         }
-        
-        MYSQL_RES* result = mysql_stmt_result_metadata(stmt);
-        if (!result) {
-            mysql_stmt_close(stmt);
-            return json::array();
+        dispatchNextRequest(client);
+        onReplyQueued(client, could_read);
+    }
+};
+
+// epoll后端: 边缘触发的就绪通知，读写由recv/writev完成
+class EpollReactor : public Reactor {
+public:
+    using Reactor::Reactor;
+    
+    ~EpollReactor() override {
+        closeAll();
+    }
+    
+    bool listen() override {
+        // 边缘触发模式下accept必须读到EAGAIN为止
+        if (!Reactor::listen()) {
+            return false;
         }
+        if (!loop->addFd(listen_fd, EPOLLIN | EPOLLET, [this](uint32_t) { acceptNewConnections(); })) {
+            LOG_ERROR("注册监听socket失败");
+            return false;
+        }
+        return true;
+    }
+    
+    void closeAll() override {
+        for (const auto& entry : clients) {
+            loop->removeFd(entry.first);
+        }
+        clients.clear();
+        connection_count.store(0, std::memory_order_relaxed);
         
-        json rankings = json::array();
-        
-        int id, user_id, gs, time_seconds;
-        bool undo;
-        char username[256], nickname[256], create_time[256];
-        unsigned long username_len, nickname_len, create_time_len;
-        
-        MYSQL_BIND result_bind[8];
-        memset(result_bind, 0, sizeof(result_bind));
-        
-        result_bind[0].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[0].buffer = &id;
-        
-        result_bind[1].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[1].buffer = &user_id;
-        
-        result_bind[2].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[2].buffer = username;
-        result_bind[2].buffer_length = sizeof(username);
-        result_bind[2].length = &username_len;
-        
-        result_bind[3].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[3].buffer = nickname;
-        result_bind[3].buffer_length = sizeof(nickname);
-        result_bind[3].length = &nickname_len;
-        
-        result_bind[4].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[4].buffer = &gs;
-        
-        result_bind[5].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[5].buffer = &time_seconds;
-        
-        result_bind[6].buffer_type = MYSQL_TYPE_TINY;
-        result_bind[6].buffer = &undo;
-        
-        result_bind[7].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[7].buffer = create_time;
-        result_bind[7].buffer_length = sizeof(create_time);
-        result_bind[7].length = &create_time_len;
-        
-        if (mysql_stmt_bind_result(stmt, result_bind) == 0) {
-            while (mysql_stmt_fetch(stmt) == 0) {
-                json ranking;
-                ranking["id"] = id;
-                ranking["user_id"] = user_id;
-                ranking["username"] = std::string(username, username_len);
-                ranking["nickname"] = std::string(nickname, nickname_len);
-                ranking["grid_size"] = gs;
-                ranking["time_seconds"] = time_seconds;
-                ranking["used_undo"] = undo;
-                ranking["create_time"] = std::string(create_time, create_time_len);
-                rankings.push_back(ranking);
+        if (listen_fd != -1) {
+            loop->removeFd(listen_fd);
+            closeListener();
+        }
+    }
+    
+    const char* backendName() const override { return "epoll"; }
+    
+protected:
+    void runLoop() override {
+        // 阻塞在epoll_wait上，只有socket就绪或定时器到期时才被唤醒
+        while (loop->isRunning()) {
+            if (loop->poll(-1) < 0) {
+                break;
             }
+            metrics.add(ServerCounter::IoSyscalls);
         }
-        
-        mysql_free_result(result);
-        mysql_stmt_close(stmt);
-        
-        std::cout << "getTimeRankings returning " << rankings.size() << " results" << std::endl;
-        return rankings;
     }
     
-    // 获取步数排行榜
-    json getStepRankings(int grid_size, bool used_undo, int limit = 50) {
-        std::string query = "SELECT r.id, r.user_id, u.username, u.nickname, r.grid_size, r.step_count, r.used_undo, r.create_time "
-                           "FROM step_rankings r JOIN users u ON r.user_id = u.id "
-                           "WHERE r.grid_size = ? AND r.used_undo = ? "
-                           "ORDER BY r.step_count ASC, r.create_time ASC LIMIT ?";
-        
-        MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-        if (!stmt) return json::array();
-        
-        if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+    void onReplyQueued(const std::shared_ptr<ClientConnection>& client, bool could_read) override {
+        bool connected = client->flushOutput();
+        if (connected && !could_read && client->canRead()) {
+            connected = readMessages(client);
         }
         
-        MYSQL_BIND bind[3];
-        memset(bind, 0, sizeof(bind));
-        
-        bind[0].buffer_type = MYSQL_TYPE_LONG;
-        bind[0].buffer = &grid_size;
-        
-        bind[1].buffer_type = MYSQL_TYPE_TINY;
-        bind[1].buffer = &used_undo;
-        
-        bind[2].buffer_type = MYSQL_TYPE_LONG;
-        bind[2].buffer = &limit;
-        
-        if (mysql_stmt_bind_param(stmt, bind) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+        if (!connected) {
+            LOG_INFO("客户端断开连接: {}", client->getIp());
+            closeClient(client->getSocket());
         }
-        
-        if (mysql_stmt_execute(stmt) != 0) {
-            mysql_stmt_close(stmt);
-            return json::array();
+    }
+    
+private:
+    std::map<int, std::shared_ptr<ClientConnection>> clients; // 只在本reactor线程中访问
+    
+    void acceptNewConnections() {
+        // 边缘触发：一次就绪事件内把accept队列全部取完
+        while (true) {
+            sockaddr_in client_addr;
+            socklen_t client_len = sizeof(client_addr);
+            
+            int client_fd = accept4(listen_fd, (struct sockaddr*)&client_addr, &client_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+            metrics.add(ServerCounter::IoSyscalls);
+            if (client_fd == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_ERROR("接受连接失败: {}", strerror(errno));
+                }
+                return;
+            }
+            
+            // 获取客户端IP
+            char client_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+            
+            LOG_INFO("新连接来自: {}", client_ip);
+            metrics.add(ServerCounter::ConnectionsAccepted);
+            
+            // 创建客户端连接并添加到本reactor的连接表
+            auto client = std::make_shared<ClientConnection>(client_fd, client_ip, metrics,
+                                                             config.output_high_water_mark);
+            clients[client_fd] = client;
+            connection_count.fetch_add(1, std::memory_order_relaxed);
+            
+            // EPOLLOUT在边缘触发下只在发送缓冲区由满变为可写时通知，常驻注册无需反复epoll_ctl
+            if (!loop->addFd(client_fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                             [this, client_fd](uint32_t events) { handleClientEvent(client_fd, events); })) {
+                LOG_ERROR("注册客户端socket失败: {}", strerror(errno));
+                closeClient(client_fd);
+            }
         }
-        
-        MYSQL_RES* result = mysql_stmt_result_metadata(stmt);
-        if (!result) {
-            mysql_stmt_close(stmt);
-            return json::array();
+    }
+    
+    void handleClientEvent(int client_fd, uint32_t events) {
+        auto it = clients.find(client_fd);
+        if (it == clients.end()) {
+            return;
         }
+        std::shared_ptr<ClientConnection> client = it->second;
         
-        json rankings = json::array();
-        
-        int id, user_id, gs, step_count;
-        bool undo;
-        char username[256], nickname[256], create_time[256];
-        unsigned long username_len, nickname_len, create_time_len;
-        
-        MYSQL_BIND result_bind[8];
-        memset(result_bind, 0, sizeof(result_bind));
-        
-        result_bind[0].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[0].buffer = &id;
-        
-        result_bind[1].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[1].buffer = &user_id;
-        
-        result_bind[2].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[2].buffer = username;
-        result_bind[2].buffer_length = sizeof(username);
-        result_bind[2].length = &username_len;
-        
-        result_bind[3].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[3].buffer = nickname;
-        result_bind[3].buffer_length = sizeof(nickname);
-        result_bind[3].length = &nickname_len;
-        
-        result_bind[4].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[4].buffer = &gs;
-        
-        result_bind[5].buffer_type = MYSQL_TYPE_LONG;
-        result_bind[5].buffer = &step_count;
-        
-        result_bind[6].buffer_type = MYSQL_TYPE_TINY;
-        result_bind[6].buffer = &undo;
-        
-        result_bind[7].buffer_type = MYSQL_TYPE_STRING;
-        result_bind[7].buffer = create_time;
-        result_bind[7].buffer_length = sizeof(create_time);
-        result_bind[7].length = &create_time_len;
-        
-        if (mysql_stmt_bind_result(stmt, result_bind) == 0) {
-            while (mysql_stmt_fetch(stmt) == 0) {
-                json ranking;
-                ranking["id"] = id;
-                ranking["user_id"] = user_id;
-                ranking["username"] = std::string(username, username_len);
-                ranking["nickname"] = std::string(nickname, nickname_len);
-                ranking["grid_size"] = gs;
-                ranking["step_count"] = step_count;
-                ranking["used_undo"] = undo;
-                ranking["create_time"] = std::string(create_time, create_time_len);
-                rankings.push_back(ranking);
-            }
+        bool disconnected = (events & (EPOLLERR | EPOLLHUP)) != 0;
+        bool could_read = client->canRead();
+        if (!disconnected && (events & EPOLLOUT)) {
+            disconnected = !client->flushOutput();
         }
         
-        mysql_free_result(result);
-        mysql_stmt_close(stmt);
+        // 暂停读取期间忽略可读事件，数据留在内核缓冲区里，恢复后一次读完
+        bool resumed = !could_read && client->canRead();
+        if (!disconnected && client->canRead() && (resumed || (events & (EPOLLIN | EPOLLRDHUP)))) {
+            disconnected = !readMessages(client);
+        }
         
-        return rankings;
+        if (disconnected) {
+            // 连接已断开
+            LOG_INFO("客户端断开连接: {}", client->getIp());
+            closeClient(client_fd);
+        }
     }
     
-    // 提交游戏结果
-    bool submitGameResult(int user_id, const std::string& game_type, int grid_size, 
-                         int max_level, int time_seconds, int step_count, bool used_undo) {
-        try {
-            if (game_type == "level") {
-                // 更新或插入关卡排行榜
-                std::string query = "INSERT INTO level_rankings (user_id, max_level) VALUES (?, ?) "
-                                   "ON DUPLICATE KEY UPDATE max_level = GREATEST(max_level, ?), update_time = NOW()";
-                
-                MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-                if (!stmt) return false;
-                
-                if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-                    mysql_stmt_close(stmt);
-                    return false;
+    // 读取并分发请求，返回false表示连接已断开
+    bool readMessages(const std::shared_ptr<ClientConnection>& client) {
+        while (true) {
+            bool would_block = false;
+            
+            // 边缘触发：读到EAGAIN为止，否则剩余数据不会再触发事件
+            while (client->canRead()) {
+                std::string message;
+                int result = client->receiveData(message);
+                if (result > 0) {
+                    client->enqueueRequest(std::move(message));
                 }
-                
-                MYSQL_BIND bind[3];
-                memset(bind, 0, sizeof(bind));
-                
-                bind[0].buffer_type = MYSQL_TYPE_LONG;
-                bind[0].buffer = &user_id;
-                
-                bind[1].buffer_type = MYSQL_TYPE_LONG;
-                bind[1].buffer = &max_level;
-                
-                bind[2].buffer_type = MYSQL_TYPE_LONG;
-                bind[2].buffer = &max_level;
-                
-                bool result = mysql_stmt_bind_param(stmt, bind) == 0 && mysql_stmt_execute(stmt) == 0;
-                mysql_stmt_close(stmt);
-                return result;
-            }
-            else if (game_type == "time") {
-                // 更新或插入时间排行榜
-                std::string query = "INSERT INTO time_rankings (user_id, grid_size, time_seconds, used_undo) VALUES (?, ?, ?, ?) "
-                                   "ON DUPLICATE KEY UPDATE time_seconds = LEAST(time_seconds, ?), create_time = IF(time_seconds > ?, NOW(), create_time)";
-                
-                MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-                if (!stmt) return false;
-                
-                if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-                    mysql_stmt_close(stmt);
+                else if (result == 0) {
                     return false;
                 }
-                
-                MYSQL_BIND bind[5];
-                memset(bind, 0, sizeof(bind));
-                
-                bind[0].buffer_type = MYSQL_TYPE_LONG;
-                bind[0].buffer = &user_id;
-                
-                bind[1].buffer_type = MYSQL_TYPE_LONG;
-                bind[1].buffer = &grid_size;
-                
-                bind[2].buffer_type = MYSQL_TYPE_LONG;
-                bind[2].buffer = &time_seconds;
-                
-                bind[3].buffer_type = MYSQL_TYPE_TINY;
-                bind[3].buffer = &used_undo;
-                
-                bind[4].buffer_type = MYSQL_TYPE_LONG;
-                bind[4].buffer = &time_seconds;
-                
-                bool result = mysql_stmt_bind_param(stmt, bind) == 0 && mysql_stmt_execute(stmt) == 0;
-                mysql_stmt_close(stmt);
-                return result;
-            }
-            else if (game_type == "step") {
-                // 更新或插入步数排行榜
-                std::string query = "INSERT INTO step_rankings (user_id, grid_size, step_count, used_undo) VALUES (?, ?, ?, ?) "
-                                   "ON DUPLICATE KEY UPDATE step_count = LEAST(step_count, ?), create_time = IF(step_count > ?, NOW(), create_time)";
-                
-                MYSQL_STMT* stmt = mysql_stmt_init(mysql);
-                if (!stmt) return false;
-                
-                if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
-                    mysql_stmt_close(stmt);
-                    return false;
+                else {
+                    would_block = true;
+                    break;
                 }
-                
-                MYSQL_BIND bind[5];
-                memset(bind, 0, sizeof(bind));
-                
-                bind[0].buffer_type = MYSQL_TYPE_LONG;
-                bind[0].buffer = &user_id;
-                
-                bind[1].buffer_type = MYSQL_TYPE_LONG;
-                bind[1].buffer = &grid_size;
-                
-                bind[2].buffer_type = MYSQL_TYPE_LONG;
-                bind[2].buffer = &step_count;
-                
-                bind[3].buffer_type = MYSQL_TYPE_TINY;
-                bind[3].buffer = &used_undo;
-                
-                bind[4].buffer_type = MYSQL_TYPE_LONG;
-                bind[4].buffer = &step_count;
-                
-                bool result = mysql_stmt_bind_param(stmt, bind) == 0 && mysql_stmt_execute(stmt) == 0;
-                mysql_stmt_close(stmt);
-                return result;
+            }
+            
+            dispatchNextRequest(client);
+            
+            // 本批请求的响应合并写出
+            if (!client->flushOutput()) {
+                return false;
+            }
+            
+            // 写出后可能解除了背压，此时socket里仍有未读数据
+            if (would_block || !client->canRead()) {
+                return true;
             }
         }
-        catch (...) {
-            return false;
+    }
+    
+    void closeClient(int client_fd) {
+        loop->removeFd(client_fd);
+        if (clients.erase(client_fd) > 0) {
+            connection_count.fetch_sub(1, std::memory_order_relaxed);
+            metrics.add(ServerCounter::ConnectionsClosed);
         }
-        return false;
     }
 };
 
-// 客户端连接类
-class ClientConnection {
-private:
-    int socket_fd;
-    std::string client_ip;
-    std::chrono::system_clock::time_point connect_time;
-    
+#ifdef PUZZLE_HAVE_IO_URING
+// io_uring后端: 每轮循环一次io_uring_enter，同时提交新请求和等待完成事件
+// - 监听socket上一个多次accept请求；每个连接一个多次recv请求，数据由内核收进共享的缓冲区环
+// - 发送队列中的帧(长度头和数据)合并成一个sendmsg请求，同一连接同一时间最多一个
+// - 工作线程的完成回调通过唤醒eventfd上的read请求取回；EventLoop的epoll fd由一个多次poll请求监视，
+//   定时器和监控端点照常由EventLoop处理
+// - 背压时取消recv请求，数据留在内核socket缓冲区里，恢复后重新提交
+// - 关闭连接时先shutdown，等该连接的请求全部完成后才释放它的缓冲区
+class UringReactor : public Reactor {
 public:
-    ClientConnection(int fd, const std::string& ip) 
-        : socket_fd(fd), client_ip(ip), connect_time(std::chrono::system_clock::now()) {}
-    
-    ~ClientConnection() {
-        if (socket_fd != -1) {
-            close(socket_fd);
-        }
+    UringReactor(int index, const ServerConfig& config, ServerMetrics& metrics, WorkerPool& workers,
+                 RequestHandler handler)
+        : Reactor(index, config, metrics, workers, std::move(handler)), ring(kRingEntries),
+          wakeup_fd(-1), wakeup_value(0), accept_armed(false), poll_armed(false), wakeup_armed(false),
+          draining(false), reported_enters(0) {
+        ring.setupBufferRing(kBufferGroup, kBufferCount, kBufferSize);
     }
     
-    int getSocket() const { return socket_fd; }
-    std::string getIp() const { return client_ip; }
+    ~UringReactor() override {
+        closeAll();
+    }
     
-    bool sendData(const std::string& data) {
-        size_t total_sent = 0;
-        size_t data_size = data.size();
-        
-        // 先发送数据长度
-        uint32_t length = htonl(data_size);
-        if (::send(socket_fd, &length, sizeof(length), 0) != sizeof(length)) {
+    // 监听socket保持阻塞模式，没有新连接时accept请求由io_uring挂起
+    bool listen() override {
+        if (!Reactor::listen()) {
             return false;
         }
+        int flags = fcntl(listen_fd, F_GETFL, 0);
+        fcntl(listen_fd, F_SETFL, flags & ~O_NONBLOCK);
+        return true;
+    }
+    
+    void closeAll() override {
+        draining = true;
+        std::vector<int> fds;
+        for (const auto& entry : clients) {
+            fds.push_back(entry.first);
+        }
+        for (int fd : fds) {
+            closeClient(fd);
+        }
+        if (accept_armed) {
+            ring.cancel(userData(Op::Accept, listen_fd), userData(Op::Cancel, 0));
+        }
+        if (poll_armed) {
+            ring.cancel(userData(Op::Poll, 0), userData(Op::Cancel, 0));
+        }
+        if (wakeup_armed) {
+            ring.cancel(userData(Op::Wakeup, 0), userData(Op::Cancel, 0));
+        }
         
-        // 再发送数据
-        while (total_sent < data_size) {
-            ssize_t sent = ::send(socket_fd, data.c_str() + total_sent, data_size - total_sent, 0);
-            if (sent <= 0) {
-                return false;
+        // 等所有请求的完成事件到达，之后内核不会再访问连接和wakeup_value的缓冲区
+        while (accept_armed || poll_armed || wakeup_armed || !clients.empty()) {
+            int ret = ring.submitAndWait(1);
+            if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+                LOG_ERROR("等待io_uring请求结束失败: {}", strerror(-ret));
+                break;
             }
-            total_sent += sent;
+            ring.forEachCompletion([this](const io_uring_cqe& cqe) { handleCompletion(cqe); });
         }
-        
-        return true;
+        closeListener();
+        connection_count.store(0, std::memory_order_relaxed);
     }
     
-    int receiveData(std::string& data) {
-        // 先接收数据长度
-        uint32_t length;
-        ssize_t received = ::recv(socket_fd, &length, sizeof(length), 0);
-        if (received <= 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // 非阻塞模式下没有数据可读
-     
-                return -1;
+    const char* backendName() const override { return "io_uring"; }
+    
+protected:
+    void runLoop() override {
+        wakeup_fd = loop->detachWakeupFd();
+        armAccept();
+        armPoll();
+        armWakeup();
+        while (loop->isRunning()) {
+            int ret = ring.submitAndWait(1);
+            if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+                LOG_ERROR("io_uring_enter失败: {}", strerror(-ret));
+                break;
             }
-            std::cout << "接收长度失败，连接断开" << std::endl;
-            return 0; // 连接断开
+            ring.forEachCompletion([this](const io_uring_cqe& cqe) { handleCompletion(cqe); });
+            metrics.add(ServerCounter::IoSyscalls, ring.enterCalls() - reported_enters);
+            reported_enters = ring.enterCalls();
         }
-        
-        if (received != sizeof(length)) {
-            std::cout << "接收长度不完整，连接断开" << std::endl;
-            return 0; // 连接断开
+    }
+    
+    void onReplyQueued(const std::shared_ptr<ClientConnection>& client, bool /*could_read*/) override {
+        int fd = client->getSocket();
+        auto it = clients.find(fd);
+        if (it == clients.end() || it->second->closing) {
+            return;
         }
+        // 解码器中可能还有因请求队列已满而留下的帧，对端可能不会再发数据，这里继续处理
+        if (client->canRead()) {
+            readFrames(fd, *it->second);
+        }
+        else {
+            queueSend(fd, *it->second);
+        }
+    }
+    
+private:
+    static constexpr unsigned kRingEntries = 1024;
+    static constexpr uint16_t kBufferGroup = 0;
+    static constexpr unsigned kBufferCount = 512;
+    static constexpr size_t kBufferSize = 4096;
+    
+    // user_data高32位为请求类型，低32位为fd
+    enum class Op : uint32_t { Accept, Poll, Wakeup, Recv, Send, Cancel };
+    
+    struct UringClient {
+        std::shared_ptr<ClientConnection> conn;
+        bool recv_armed = false;        // 多次recv请求仍有效(包括已请求取消)
+        bool recv_cancelling = false;
+        bool send_in_flight = false;
+        bool closing = false;
+        iovec iov[ClientConnection::kMaxIov];  // sendmsg完成前保持有效
+        msghdr msg{};
+    };
+    
+    IoUring ring;
+    std::map<int, std::unique_ptr<UringClient>> clients; // 只在本reactor线程中访问
+    int wakeup_fd;                  // EventLoop的唤醒eventfd，由EventLoop关闭
+    uint64_t wakeup_value;          // 唤醒eventfd的read缓冲区
+    bool accept_armed;
+    bool poll_armed;
+    bool wakeup_armed;
+    bool draining;                  // closeAll中: 只收尾，不再处理新事件
+    uint64_t reported_enters;       // 已计入指标的io_uring_enter次数
+    
+    static uint64_t userData(Op op, int fd) {
+        return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+    }
+    
+    void armAccept() {
+        accept_armed = ring.acceptMultishot(listen_fd, userData(Op::Accept, listen_fd));
+        if (!accept_armed) {
+            LOG_ERROR("提交accept请求失败");
+        }
+    }
+    
+    void armPoll() {
+        poll_armed = ring.pollMultishot(loop->fd(), userData(Op::Poll, 0));
+        if (!poll_armed) {
+            LOG_ERROR("提交poll请求失败");
+        }
+    }
+    
+    void armWakeup() {
+        wakeup_armed = ring.read(wakeup_fd, &wakeup_value, sizeof(wakeup_value), userData(Op::Wakeup, 0));
+        if (!wakeup_armed) {
+            LOG_ERROR("提交eventfd read请求失败");
+        }
+    }
+    
+    void handleCompletion(const io_uring_cqe& cqe) {
+        Op op = static_cast<Op>(cqe.user_data >> 32);
+        int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFFu);
+        bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        switch (op) {
+            case Op::Accept:
+                onAccepted(cqe.res, more);
+                break;
+            case Op::Poll:
+                onLoopReady(more);
+                break;
+            case Op::Wakeup:
+                onWakeup(cqe.res);
+                break;
+            case Op::Recv:
+                onReceived(fd, cqe.res, cqe.flags, more);
+                break;
+            case Op::Send:
+                onSent(fd, cqe.res);
+                break;
+            case Op::Cancel:
+                break;
+        }
+    }
+    
+    void onAccepted(int res, bool more) {
+        if (!more) {
+            accept_armed = false;
+        }
+        if (res >= 0) {
+            if (draining) {
+                close(res);
+            }
+            else {
+                addClient(res);
+            }
+        }
+        else if (res != -ECANCELED) {
+            LOG_ERROR("接受连接失败: {}", strerror(-res));
+        }
+        if (!accept_armed && !draining) {
+            armAccept();
+        }
+    }
+    
+    // 定时器、跨线程任务或监控端点就绪: 交给EventLoop处理，取满一轮时继续取
+    void onLoopReady(bool more) {
+        if (!more) {
+            poll_armed = false;
+        }
+        if (draining) {
+            return;
+        }
+        int n;
+        do {
+            n = loop->poll(0);
+            metrics.add(ServerCounter::IoSyscalls);
+        } while (n == EventLoop::maxEvents());
+        if (!poll_armed && loop->isRunning()) {
+            armPoll();
+        }
+    }
+    
+    // 工作线程的完成回调(发送响应)和stop()都通过eventfd唤醒
+    void onWakeup(int res) {
+        wakeup_armed = false;
+        if (draining) {
+            return;
+        }
+        if (res < 0 && res != -EINTR && res != -EAGAIN) {
+            LOG_ERROR("读取唤醒eventfd失败: {}", strerror(-res));
+            return;
+        }
+        loop->runPendingTasks();
+        if (loop->isRunning()) {
+            armWakeup();
+        }
+    }
+    
+    void addClient(int fd) {
+        // 获取客户端IP
+        sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+        char client_ip[INET_ADDRSTRLEN] = "";
+        if (getpeername(fd, (struct sockaddr*)&client_addr, &client_len) == 0) {
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        }
+        metrics.add(ServerCounter::IoSyscalls);
         
-        length = ntohl(length);
-        std::cout << "接收到数据长度: " << length << std::endl;
+        LOG_INFO("新连接来自: {}", client_ip);
+        metrics.add(ServerCounter::ConnectionsAccepted);
         
-        if (length > 1024 * 1024) { // 限制最大1MB
-            std::cout << "数据长度超过限制，连接断开" << std::endl;
-            return 0; // 连接断开
+        auto state = std::make_unique<UringClient>();
+        state->conn = std::make_shared<ClientConnection>(fd, client_ip, metrics, config.output_high_water_mark);
+        UringClient& client = *state;
+        clients[fd] = std::move(state);
+        connection_count.fetch_add(1, std::memory_order_relaxed);
+        armRecv(fd, client);
+    }
+    
+    void onReceived(int fd, int res, uint32_t flags, bool more) {
+        auto it = clients.find(fd);
+        bool has_buffer = res > 0 && (flags & IORING_CQE_F_BUFFER);
+        uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (it == clients.end()) {
+            if (has_buffer) ring.recycleBuffer(bid);
+            return;
         }
         
-        // 再接收数据
-        data.resize(length);
-        size_t total_received = 0;
+        UringClient& client = *it->second;
+        if (!more) {
+            client.recv_armed = false;
+            client.recv_cancelling = false;
+        }
         
-        while (total_received < length) {
-            ssize_t rec = ::recv(socket_fd, &data[total_received], length - total_received, 0);
-            if (rec <= 0) {
-                if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                    // 非阻塞模式下没有数据可读，稍后重试
-                    std::cout << "接收数据时非阻塞模式，稍后重试" << std::endl;
-                    continue;
-                }
-                std::cout << "接收数据失败，连接断开" << std::endl;
-                return 0; // 连接断开
+        bool disconnected = false;
+        if (has_buffer) {
+            if (!client.closing) {
+                disconnected = !client.conn->feed(ring.buffer(bid), static_cast<size_t>(res));
             }
-            total_received += rec;
+            ring.recycleBuffer(bid);
+        }
+        else if (res == 0) {
+            client.conn->onPeerClosed();
+            disconnected = true;
+        }
+        else if (res < 0 && res != -ENOBUFS && res != -ECANCELED) {
+            // -ENOBUFS: 缓冲区暂时用完，请求结束，下面重新提交
+            LOG_WARN("接收数据失败，连接断开: {}", strerror(-res));
+            disconnected = true;
         }
         
-        std::cout << "成功接收数据，长度: " << total_received << std::endl;
-        return 1; // 成功接收数据
+        if (client.closing) {
+            releaseIfIdle(fd, client);
+        }
+        else if (disconnected) {
+            LOG_INFO("客户端断开连接: {}", client.conn->getIp());
+            closeClient(fd);
+        }
+        else {
+            readFrames(fd, client);
+        }
+    }
+    
+    void onSent(int fd, int res) {
+        auto it = clients.find(fd);
+        if (it == clients.end()) {
+            return;
+        }
+        UringClient& client = *it->second;
+        client.send_in_flight = false;
+        if (client.closing) {
+            releaseIfIdle(fd, client);
+            return;
+        }
+        if (res < 0) {
+            LOG_INFO("客户端断开连接: {}", client.conn->getIp());
+            closeClient(fd);
+            return;
+        }
+        
+        client.conn->onOutputSent(static_cast<size_t>(res));
+        if (client.conn->canRead()) {
+            readFrames(fd, client);
+        }
+        else {
+            queueSend(fd, client);
+        }
+    }
+    
+    // 取出已解码的请求并分发，写出响应；背压时取消recv，解除后重新提交
+    void readFrames(int fd, UringClient& client) {
+        std::string message;
+        while (client.conn->canRead() && client.conn->nextFrame(message)) {
+            client.conn->enqueueRequest(std::move(message));
+        }
+        dispatchNextRequest(client.conn);
+        if (!queueSend(fd, client)) {
+            return;
+        }
+        
+        if (client.conn->canRead()) {
+            armRecv(fd, client);
+        }
+        else if (client.recv_armed && !client.recv_cancelling) {
+            client.recv_cancelling = ring.cancel(userData(Op::Recv, fd), userData(Op::Cancel, fd));
+        }
+    }
+    
+    void armRecv(int fd, UringClient& client) {
+        if (client.recv_armed || client.closing) {
+            return;
+        }
+        client.recv_armed = ring.recvMultishot(fd, kBufferGroup, userData(Op::Recv, fd));
+        if (!client.recv_armed) {
+            LOG_ERROR("提交recv请求失败，关闭连接: {}", client.conn->getIp());
+            closeClient(fd);
+        }
+    }
+    
+    // 返回false表示连接已关闭，client不能再使用
+    bool queueSend(int fd, UringClient& client) {
+        if (client.send_in_flight || client.closing || !client.conn->hasPendingOutput()) {
+            return true;
+        }
+        client.msg = msghdr();
+        client.msg.msg_iov = client.iov;
+        client.msg.msg_iovlen = client.conn->fillOutputIov(client.iov, ClientConnection::kMaxIov);
+        client.send_in_flight = ring.sendmsg(fd, &client.msg, userData(Op::Send, fd));
+        if (!client.send_in_flight) {
+            LOG_ERROR("提交sendmsg请求失败，关闭连接: {}", client.conn->getIp());
+            closeClient(fd);
+            return false;
+        }
+        return true;
+    }
+    
+    // shutdown让进行中的recv/sendmsg尽快结束，完成事件全部到达后再释放连接
+    void closeClient(int fd) {
+        auto it = clients.find(fd);
+        if (it == clients.end() || it->second->closing) {
+            return;
+        }
+        UringClient& client = *it->second;
+        client.closing = true;
+        connection_count.fetch_sub(1, std::memory_order_relaxed);
+        metrics.add(ServerCounter::ConnectionsClosed);
+        shutdown(fd, SHUT_RDWR);
+        releaseIfIdle(fd, client);
     }
     
-    void setNonBlocking() {
-        int flags = fcntl(socket_fd, F_GETFL, 0);
-        fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
+    void releaseIfIdle(int fd, UringClient& client) {
+        if (client.closing && !client.recv_armed && !client.send_in_flight) {
+            clients.erase(fd);
+        }
     }
 };
+#endif // PUZZLE_HAVE_IO_URING
 
 // 服务器类
 class PuzzleGameServer {
 private:
     ServerConfig config;
-    int server_fd;
-    std::map<int, std::shared_ptr<ClientConnection>> clients;
-    std::map<std::string, std::shared_ptr<Session>> sessions;
-    std::mutex clients_mutex;
-    std::mutex sessions_mutex;
+    ServerMetrics metrics;              // 声明在reactors之前，连接析构时仍可记录
+    int metrics_fd;
+    std::map<int, std::string> metrics_requests; // 监控端点上尚未读完的HTTP请求
+    SessionTokens sessions;
     std::unique_ptr<Database> db;
+    LeaderboardEngine leaderboard;
+    std::unique_ptr<SubmitQueue> submit_queue; // 声明在db之后，先于db析构
+    std::vector<std::unique_ptr<Reactor>> reactors; // reactors[0]同时负责定时器和监控端点
+    std::unique_ptr<WorkerPool> workers; // 声明在reactors之后，先于事件循环析构
+    std::mutex revocation_poll_mutex;    // 同一时间只有一个工作线程读取吊销记录
+    int64_t revocations_polled_ms;       // 上次成功读取的时间(毫秒)，受revocation_poll_mutex保护
+    std::mutex leaderboard_reload_mutex; // 同一时间只有一个工作线程重新合并排行榜
     bool running;
     
+    static constexpr int64_t kRevocationOverlapMs = 60000; // 每次多读这么久，覆盖进程间时钟偏差和写入延迟
+    
 public:
-    PuzzleGameServer(const ServerConfig& cfg) : config(cfg), running(false) {}
+    PuzzleGameServer(const ServerConfig& cfg)
+        : config(cfg), metrics_fd(-1), sessions(cfg.session_secret, std::chrono::seconds(cfg.session_timeout_seconds)),
+          revocations_polled_ms(0), running(false) {}
     
     ~PuzzleGameServer() {
         stop();
     }
     
     bool start() {
-        // 创建服务器socket
-        server_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd == -1) {
-            std::cerr << "创建socket失败" << std::endl;
+        int log_level;
+        if (parseLogLevel(config.log_level, log_level)) {
+            Logger::instance().setLevel(log_level);
+        }
+        else {
+            LOG_WARN("未知的日志级别: {}，使用默认级别", config.log_level);
+        }
+        
+        // JSON解析和数据库访问放到工作线程，I/O线程只负责收发
+        workers = std::make_unique<WorkerPool>(config.worker_threads, config.worker_queue_depth);
+        
+        // 每个I/O线程一个监听socket，先于存储后端初始化，端口被占用时尽早失败
+        int reactor_count = std::max(1, config.reactor_threads);
+        try {
+            for (int i = 0; i < reactor_count; ++i) {
+                reactors.push_back(createReactor(i));
+                if (!reactors.back()->listen()) {
+                    reactors.clear();
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            LOG_ERROR("事件循环初始化失败: {}", e.what());
+            reactors.clear();
             return false;
         }
         
-        // 设置socket选项
-        int opt = 1;
-        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-            std::cerr << "设置socket选项失败" << std::endl;
-            close(server_fd);
+        // 初始化存储后端
+        try {
+            db = createDatabase(config);
+        }
+        catch (const std::exception& e) {
+            LOG_ERROR("存储后端初始化失败: {}", e.what());
+            reactors.clear();
             return false;
         }
+        LOG_INFO("存储后端: {}", config.storage_backend);
         
-        // 绑定地址和端口
-        sockaddr_in server_addr;
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(config.port);
+        // 重启前和其他进程中注销的会话
+        pollSessionRevocations();
         
-        if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            std::cerr << "绑定失败" << std::endl;
-            close(server_fd);
-            return false;
+        // 加载内存排行榜，失败时排行榜查询回退到数据库
+        loadLeaderboard();
+        
+        if (config.submit_write_behind) {
+            submit_queue = std::make_unique<SubmitQueue>(*db, config.submit_flush_interval_ms,
+                                                         config.submit_batch_rows, config.submit_queue_limit);
         }
         
-        // 开始监听
-        if (listen(server_fd, config.max_connections) < 0) {
-            std::cerr << "监听失败" << std::endl;
-            close(server_fd);
+        EventLoop& loop = reactors[0]->eventLoop();
+        
+        // 会话过期检查由timerfd驱动
+        if (loop.addTimer(std::chrono::seconds(1), [this]() { cleanupExpiredSessions(); }) == -1) {
+            LOG_ERROR("创建会话清理定时器失败");
+            reactors.clear();
             return false;
         }
         
-        // 初始化数据库
-        try {
-            db = std::make_unique<Database>(config);
+        // 空闲数据库连接的健康检查会阻塞在网络上、日志压缩会写文件，交给工作线程执行
+        auto health_interval = std::chrono::milliseconds(std::max(1000, config.db_validate_idle_ms / 2));
+        loop.addTimer(health_interval, [this]() {
+            workers->submit([this]() { db->healthCheck(); });
+        });
+        
+        // 登录只把最后登录时间记在内存中，定时批量写入
+        loop.addTimer(std::chrono::milliseconds(std::max(100, config.last_login_flush_ms)), [this]() {
+            workers->submit([this]() { db->flushPendingWrites(); });
+        });
+        
+        // 使用同一数据库的其他进程注销的会话，延迟不超过这个间隔
+        if (config.session_revocation_poll_ms > 0) {
+            loop.addTimer(std::chrono::milliseconds(std::max(100, config.session_revocation_poll_ms)), [this]() {
+                workers->submit([this]() { pollSessionRevocations(); });
+            });
         }
-        catch (const std::exception& e) {
-            std::cerr << "数据库连接失败: " << e.what() << std::endl;
-            close(server_fd);
-            return false;
+        
+        // 内存排行榜只包含本进程提交的成绩，其他进程写入同一数据库的成绩由定时合并带入
+        if (config.leaderboard_reload_ms > 0) {
+            loop.addTimer(std::chrono::milliseconds(std::max(1000, config.leaderboard_reload_ms)), [this]() {
+                workers->submit([this]() { reloadLeaderboard(); });
+            });
         }
         
-        running = true;
-        std::cout << "服务器启动成功，监听端口: " << config.port << std::endl;
+        if (submit_queue) {
+            loop.addTimer(std::chrono::seconds(60), [this]() { logSubmitStats(); });
+        }
         
-        // 设置非阻塞
-        int flags = fcntl(server_fd, F_GETFL, 0);
-        fcntl(server_fd, F_SETFL, flags | O_NONBLOCK);
+        if (config.metrics_port > 0 && !startMetricsEndpoint()) {
+            LOG_WARN("监控端口{}监听失败，不提供/metrics", config.metrics_port);
+        }
+        
+        if (config.session_secret.empty()) {
+            LOG_WARN("未配置会话密钥(PUZZLE_SESSION_SECRET)，使用随机密钥，重启后需要重新登录");
+        }
+        
+        running = true;
+        LOG_INFO("服务器启动成功，监听端口: {}，I/O线程: {}({})，工作线程: {}",
+                 config.port, reactors.size(), reactors[0]->backendName(), workers->threadCount());
         
         return true;
     }
     
+    // 读取上次之后新增的吊销记录；第一次读取令牌有效期内的全部记录
+    void pollSessionRevocations() {
+        std::unique_lock<std::mutex> lock(revocation_poll_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        bool first = revocations_polled_ms == 0;
+        int64_t since_ms = first ? now_ms - sessions.lifetimeSeconds() * 1000
+                                 : revocations_polled_ms - kRevocationOverlapMs;
+        size_t loaded = 0;
+        bool ok = db->loadSessionRevocations(since_ms, [this, &loaded](int user_id, int64_t revoked_before_ms) {
+            sessions.applyRevocation(user_id, revoked_before_ms);
+            ++loaded;
+        });
+        if (!ok) {
+            LOG_WARN("读取会话吊销记录失败，稍后重试");
+            return;
+        }
+        revocations_polled_ms = now_ms;
+        if (first) {
+            LOG_INFO("会话吊销记录加载完成: {} 个用户", loaded);
+        }
+    }
+    
+    void loadLeaderboard() {
+        auto start = std::chrono::steady_clock::now();
+        size_t loaded = 0;
+        for (RankingType type : {RankingType::Level, RankingType::Time, RankingType::Step}) {
+            bool ok = db->loadRankings(type, [this, type, &loaded](const RankingEntry& entry) {
+                leaderboard.load(type, entry);
+                ++loaded;
+            });
+            if (!ok) {
+                LOG_WARN("加载内存排行榜失败，排行榜查询将直接访问数据库");
+                return;
+            }
+        }
+        leaderboard.setReady(true);
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("内存排行榜加载完成: {} 条记录，耗时 {}ms", loaded, elapsed);
+    }
+    
+    // 按提交成绩的规则把数据库中的全部记录合并到内存排行榜，已有的更好成绩不会被覆盖
+    // 启动时加载失败的话在这里重新加载
+    void reloadLeaderboard() {
+        std::unique_lock<std::mutex> lock(leaderboard_reload_mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return;
+        }
+        if (!leaderboard.isReady()) {
+            loadLeaderboard();
+            return;
+        }
+        for (RankingType type : {RankingType::Level, RankingType::Time, RankingType::Step}) {
+            bool ok = db->loadRankings(type, [this, type](const RankingEntry& entry) {
+                leaderboard.submit(type, entry);
+            });
+            if (!ok) {
+                LOG_WARN("重新合并内存排行榜失败，稍后重试");
+                return;
+            }
+        }
+    }
+    
     void stop() {
         if (!running) return;
         
         running = false;
         
+        for (auto& reactor : reactors) {
+            reactor->stop();
+        }
+        for (auto& reactor : reactors) {
+            reactor->join();
+        }
+        
+        // 等待正在处理的请求结束，之后投递到loop的完成回调不会再执行
+        if (workers) {
+            workers->shutdown();
+        }
+        
+        // 队列中的成绩写完(或以失败答复)后再退出；此时I/O线程已停止，响应不再发送，客户端会重新提交
+        if (submit_queue) {
+            submit_queue->shutdown();
+            logSubmitStats();
+        }
+        db->flushPendingWrites();
+        
         // 关闭所有客户端连接
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        clients.clear();
+        for (auto& reactor : reactors) {
+            reactor->closeAll();
+        }
         
-        if (server_fd != -1) {
-            close(server_fd);
-            server_fd = -1;
+        EventLoop& loop = reactors[0]->eventLoop();
+        for (const auto& entry : metrics_requests) {
+            loop.removeFd(entry.first);
+            close(entry.first);
+        }
+        metrics_requests.clear();
+        if (metrics_fd != -1) {
+            loop.removeFd(metrics_fd);
+            close(metrics_fd);
+            metrics_fd = -1;
         }
         
-        std::cout << "服务器已停止" << std::endl;
+        LOG_INFO("服务器已停止");
     }
     
-    void run() {
-        while (running) {
-            // 接受新连接
-            acceptNewConnections();
-            
-            // 处理客户端消息
-            handleClientMessages();
-            
-            // 清理过期会话
-            cleanupExpiredSessions();
-            
-            // 短暂休眠
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // 批量写入的批次大小和提交耗时
+    void logSubmitStats() {
+        SubmitQueueStats stats = submit_queue->getStats();
+        if (stats.batches == 0 && stats.failed_batches == 0) {
+            return;
         }
+        LOG_INFO("成绩写入: {} 条成绩, {} 批, {} 行, 平均每批 {} 行(最大批次 {} 条成绩), 提交平均 {}ms(最长 {}ms), "
+                 "最长延迟 {}ms, 失败 {} 批, 失败答复 {}, 拒绝 {}, 待写入 {}",
+                 stats.submitted, stats.batches, stats.written_rows,
+                 stats.written_rows / std::max<uint64_t>(1, stats.batches), stats.max_batch,
+                 stats.total_flush_us / std::max<uint64_t>(1, stats.batches) / 1000.0,
+                 stats.max_flush_us / 1000.0, stats.max_delay_us / 1000.0,
+                 stats.failed_batches, stats.failed_results, stats.rejected, stats.pending);
     }
-    
-private:
-    void acceptNewConnections() {
-        sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        
-        int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &client_len);
-        if (client_fd == -1) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                std::cerr << "接受连接失败: " << strerror(errno) << std::endl;
-            }
-            return;
+    
+    // 让run()返回，只写原子变量和eventfd，可以在信号处理函数中调用
+    void requestStop() {
+        for (auto& reactor : reactors) {
+            reactor->stop();
         }
-        
-        // 获取客户端IP
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-        
-        std::cout << "新连接来自: " << client_ip << std::endl;
-        
-        // 创建客户端连接
-        auto client = std::make_shared<ClientConnection>(client_fd, client_ip);
-        client->setNonBlocking();
-        
-        // 添加到客户端列表
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        clients[client_fd] = client;
     }
     
-    void handleClientMessages() {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        
-        auto it = clients.begin();
-        while (it != clients.end()) {
-            auto client = it->second;
-            std::string message;
-            
-            int result = client->receiveData(message);
-            if (result > 0) {
-                // 成功接收到数据，处理消息
-                handleClientMessage(client, message);
-                ++it;
-            }
-            else if (result == 0) {
-                // 连接已断开
-                std::cout << "客户端断开连接: " << client->getIp() << std::endl;
-                it = clients.erase(it);
+    void run() {
+        // reactor 1..N-1在各自的线程中运行，reactor 0在当前线程中运行
+        // 阻塞在epoll_wait上，只有socket就绪或定时器到期时才被唤醒
+        for (size_t i = 1; i < reactors.size(); ++i) {
+            reactors[i]->startThread();
+        }
+        reactors[0]->run();
+    }
+    
+private:
+    // 按配置创建I/O线程，io_uring不可用(编译环境缺少头文件或内核不支持)时回退到epoll
+    std::unique_ptr<Reactor> createReactor(int index) {
+        Reactor::RequestHandler handler = [this](const std::string& message, std::chrono::steady_clock::time_point dispatched_at,
+                                                 const ReplySink& deferred_reply) {
+            return handleClientMessage(message, dispatched_at, deferred_reply);
+        };
+        if (config.io_backend == "io_uring") {
+#ifdef PUZZLE_HAVE_IO_URING
+            try {
+                return std::make_unique<UringReactor>(index, config, metrics, *workers, std::move(handler));
             }
-            else {
-                // 暂时没有数据，继续下一个客户端
-                ++it;
+            catch (const std::exception& e) {
+                LOG_WARN("io_uring初始化失败({})，使用epoll", e.what());
             }
+#else
+            LOG_WARN("编译时未启用io_uring，使用epoll");
+#endif
+            config.io_backend = "epoll";
+        }
+        else if (config.io_backend != "epoll") {
+            LOG_WARN("未知的网络后端: {}，使用epoll", config.io_backend);
+            config.io_backend = "epoll";
         }
+        return std::make_unique<EpollReactor>(index, config, metrics, *workers, std::move(handler));
     }
     
-    void handleClientMessage(std::shared_ptr<ClientConnection> client, const std::string& message) {
+    // 在工作线程中执行：解析请求并返回序列化后的响应
+    // dispatched_at为I/O线程分发请求的时间，各阶段耗时按请求类型记入延迟直方图
+    // 返回deferred的响应由deferred_reply稍后投递，耗时在投递时记录
+    Reply handleClientMessage(const std::string& message, std::chrono::steady_clock::time_point dispatched_at,
+                              const ReplySink& deferred_reply) {
+        // 每个工作线程复用一份解析结果，字符串容量稳定后解析不再分配内存
+        thread_local RequestFields request;
+        
+        auto start = std::chrono::steady_clock::now();
+        RequestTiming timing;
+        timing.kind = ServerMetrics::kOtherKind;
+        timing.queue_us = elapsedMicros(dispatched_at, start);
+        DbTimer::take();
         try {
-            json request = json::parse(message);
-            std::string type = request["type"];
-            
-            json response;
-            
-            if (type == "register") {
-                response = handleRegister(request);
-            }
-            else if (type == "login") {
-                response = handleLogin(request);
-            }
-            else if (type == "get_level_rankings") {
-                response = handleGetLevelRankings(request);
-            }
-            else if (type == "get_time_rankings") {
-                std::cout << "Processing get_time_rankings request" << std::endl;
-                response = handleGetTimeRankings(request);
-                std::cout << "get_time_rankings response prepared" << std::endl;
-            }
-            else if (type == "get_step_rankings") {
-                response = handleGetStepRankings(request);
-            }
-            else if (type == "submit_game_result") {
-                response = handleSubmitGameResult(request);
-            }
-            else {
-                response = {
-                    {"type", "error"},
-                    {"success", false},
-                    {"message", "未知请求类型"},
-                    {"error_code", "INVALID_REQUEST"}
-                };
+            if (!RequestParser::parse(message, request)) {
+                throw std::invalid_argument("消息格式错误");
             }
+            timing.kind = static_cast<int>(request.type);
+            auto parsed = std::chrono::steady_clock::now();
+            timing.parse_us = elapsedMicros(start, parsed);
             
-            // 发送响应
-            std::cout << "Sending response for type: " << type << ", size: " << response.dump().length() << " bytes" << std::endl;
-            client->sendData(response.dump());
+            Reply reply = dispatchRequest(request, timing, parsed, deferred_reply);
+            if (!reply.deferred) {
+                metrics.recordRequest(timing);
+            }
+            return reply;
         }
         catch (const std::exception& e) {
             json error_response = {
@@ -923,18 +1386,263 @@ private:
                 {"message", "消息解析失败"},
                 {"error_code", "INVALID_REQUEST"}
             };
-            client->sendData(error_response.dump());
+            timing.success = false;
+            metrics.recordRequest(timing);
+            return Reply{error_response.dump(), SharedFrame()};
+        }
+    }
+    
+    using MessageHandler = Reply (PuzzleGameServer::*)(const RequestFields&, RequestTiming&,
+                                                        std::chrono::steady_clock::time_point, const ReplySink&);
+    
+    // 按请求类型查表分发，表的下标与MessageType一致
+    // 排行榜页直接写成响应帧，成绩提交在写入后响应，其余请求由处理函数返回json后再序列化
+    Reply dispatchRequest(const RequestFields& request, RequestTiming& timing,
+                          std::chrono::steady_clock::time_point parsed, const ReplySink& deferred_reply) {
+        static constexpr MessageHandler kHandlers[] = {
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleRegister>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleLogin>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleLogout>,
+            &PuzzleGameServer::rankingRoute<RankingType::Level>,
+            &PuzzleGameServer::rankingRoute<RankingType::Time>,
+            &PuzzleGameServer::rankingRoute<RankingType::Step>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleGetMyRank>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleGetRankingsAround>,
+            &PuzzleGameServer::submitRoute<&PuzzleGameServer::parseSubmitGameResult>,
+            &PuzzleGameServer::submitRoute<&PuzzleGameServer::parseSubmitGameResults>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleServerStats>,
+            &PuzzleGameServer::jsonRoute<&PuzzleGameServer::handleUnknownRequest>
+        };
+        static_assert(sizeof(kHandlers) / sizeof(kHandlers[0]) == kMessageTypeCount, "kHandlers与MessageType不一致");
+        return (this->*kHandlers[static_cast<int>(request.type)])(request, timing, parsed, deferred_reply);
+    }
+    
+    template <json (PuzzleGameServer::*Handler)(const RequestFields&)>
+    Reply jsonRoute(const RequestFields& request, RequestTiming& timing,
+                    std::chrono::steady_clock::time_point parsed, const ReplySink&) {
+        json response = (this->*Handler)(request);
+        
+        // 已过去一半有效期的令牌随响应换发，客户端用新令牌替换旧令牌
+        if (request.type != MessageType::Logout && response.value("success", false)) {
+            refreshSessionToken(request, response);
+        }
+        return jsonReply(response, timing, parsed);
+    }
+    
+    // 记录处理耗时并序列化响应，数据库耗时从处理阶段中扣除
+    Reply jsonReply(const json& response, RequestTiming& timing, std::chrono::steady_clock::time_point parsed) {
+        timing.success = response.value("success", false);
+        auto handled = std::chrono::steady_clock::now();
+        uint64_t elapsed = elapsedMicros(parsed, handled);
+        timing.db_us += DbTimer::take();
+        timing.handler_us = elapsed - std::min(timing.db_us, elapsed);
+        
+        std::string payload = response.dump();
+        timing.serialize_us = elapsedMicros(handled, std::chrono::steady_clock::now());
+        LOG_DEBUG("发送响应: {}, {} 字节", response.value("type", ""), payload.length());
+        return Reply{std::move(payload), SharedFrame()};
+    }
+    
+    using SubmitParser = json (PuzzleGameServer::*)(const RequestFields&, Session&, std::vector<GameResult>&);
+    
+    // 成绩提交: 解析和会话验证在工作线程中完成
+    // 启用写入队列时工作线程不等待，成绩所在批次提交后才在写入线程中更新内存排行榜并投递响应，
+    // 客户端收到成功时成绩已经持久化；最终写入失败时返回失败，客户端可以重新提交
+    template <SubmitParser Parse>
+    Reply submitRoute(const RequestFields& request, RequestTiming& timing,
+                      std::chrono::steady_clock::time_point parsed, const ReplySink& deferred_reply) {
+        Session session;
+        std::vector<GameResult> results;
+        json error = (this->*Parse)(request, session, results);
+        if (!error.is_null()) {
+            return jsonReply(error, timing, parsed);
+        }
+        
+        MessageType type = request.type;
+        if (!submit_queue) {
+            // 同步写库，单条成绩可以拿到新行的id
+            int row_id = 0;
+            bool ok;
+            {
+                DbTimer db_timer;
+                if (type == MessageType::SubmitGameResult) {
+                    const GameResult& result = results.front();
+                    ok = db->submitGameResult(result.user_id, request.data.game_type, result.grid_size,
+                                              result.type == RankingType::Level ? result.score : 0,
+                                              result.type == RankingType::Time ? result.score : 0,
+                                              result.type == RankingType::Step ? result.score : 0,
+                                              result.used_undo, &row_id);
+                }
+                else {
+                    ok = db->submitGameResults(results);
+                }
+            }
+            json response = submitResponse(type, ok, results.size());
+            if (ok) {
+                for (const GameResult& result : results) {
+                    applyToLeaderboard(result, row_id, session.username, session.nickname);
+                }
+                refreshSessionToken(request, response);
+            }
+            return jsonReply(response, timing, parsed);
+        }
+        
+        // 请求字段在工作线程中复用，回调只使用这里复制出的值；新行的id在重新加载排行榜前保持为0
+        // 入队到所在批次提交的等待计入数据库阶段
+        std::string token = refreshedSessionToken(request);
+        auto queued_at = std::chrono::steady_clock::now();
+        bool queued = submit_queue->submit(results,
+            [this, type, session, results, token, timing, parsed, queued_at, deferred_reply](bool committed) mutable {
+                timing.db_us += elapsedMicros(queued_at, std::chrono::steady_clock::now());
+                json response = submitResponse(type, committed, results.size());
+                if (committed) {
+                    for (const GameResult& result : results) {
+                        applyToLeaderboard(result, 0, session.username, session.nickname);
+                    }
+                    if (!token.empty()) {
+                        response["session_id"] = token;
+                    }
+                }
+                Reply reply = jsonReply(response, timing, parsed);
+                metrics.recordRequest(timing);
+                deferred_reply(std::move(reply));
+            });
+        if (!queued) {
+            json response = {
+                {"type", submitResponseType(type)},
+                {"success", false},
+                {"message", "服务器繁忙，请稍后重试"},
+                {"error_code", "SERVER_BUSY"}
+            };
+            return jsonReply(response, timing, parsed);
+        }
+        Reply reply;
+        reply.deferred = true;
+        return reply;
+    }
+    
+    static const char* submitResponseType(MessageType type) {
+        return type == MessageType::SubmitGameResult ? "submit_result_response" : "submit_results_response";
+    }
+    
+    static json submitResponse(MessageType type, bool ok, size_t count) {
+        if (!ok) {
+            return {
+                {"type", submitResponseType(type)},
+                {"success", false},
+                {"message", "数据提交失败"},
+                {"error_code", "DATABASE_ERROR"}
+            };
+        }
+        json response = {
+            {"type", submitResponseType(type)},
+            {"success", true},
+            {"message", "数据提交成功"}
+        };
+        if (type == MessageType::SubmitGameResults) {
+            response["data"] = {{"accepted", count}};
+        }
+        return response;
+    }
+    
+    // 排行榜响应在读取时就已经写成帧，没有单独的序列化阶段
+    template <RankingType Type>
+    Reply rankingRoute(const RequestFields& request, RequestTiming& timing,
+                       std::chrono::steady_clock::time_point parsed, const ReplySink&) {
+        SharedFrame frame = rankingFrame(Type, request, timing.success);
+        uint64_t elapsed = elapsedMicros(parsed, std::chrono::steady_clock::now());
+        timing.db_us = DbTimer::take();
+        timing.handler_us = elapsed - std::min(timing.db_us, elapsed);
+        LOG_DEBUG("发送响应: {}, {} 字节", request.type_name, frame->size() - 4);
+        return Reply{std::string(), std::move(frame)};
+    }
+    
+    json handleUnknownRequest(const RequestFields&) {
+        return {
+            {"type", "error"},
+            {"success", false},
+            {"message", "未知请求类型"},
+            {"error_code", "INVALID_REQUEST"}
+        };
+    }
+    
+    static uint64_t elapsedMicros(std::chrono::steady_clock::time_point from,
+                                  std::chrono::steady_clock::time_point to) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+        return us > 0 ? static_cast<uint64_t>(us) : 0;
+    }
+    
+    // 运行指标: 各类请求的次数、错误数和分阶段延迟，连接和流量，数据库连接池和成绩写入队列
+    json handleServerStats(const RequestFields&) {
+        ServerMetrics::Snapshot snap = metrics.snapshot();
+        json data = ServerMetrics::toJson(snap);
+        
+        DBPoolStats pool = db->getPoolStats();
+        data["db_pool"] = {
+            {"checkouts", pool.checkouts},
+            {"waits", pool.waits},
+            {"timeouts", pool.timeouts},
+            {"total_wait_us", pool.total_wait_us},
+            {"max_wait_us", pool.max_wait_us},
+            {"open_connections", pool.open_connections},
+            {"idle_connections", pool.idle_connections}
+        };
+        UserCacheStats users = db->getUserCacheStats();
+        data["user_cache"] = {
+            {"hits", users.hits},
+            {"misses", users.misses},
+            {"evictions", users.evictions},
+            {"expirations", users.expirations},
+            {"size", users.size},
+            {"pending_logins", users.pending_logins},
+            {"flushed_logins", users.flushed_logins},
+            {"failed_flushes", users.failed_flushes}
+        };
+        if (submit_queue) {
+            SubmitQueueStats submit = submit_queue->getStats();
+            data["submit_queue"] = {
+                {"submitted", submit.submitted},
+                {"rejected", submit.rejected},
+                {"batches", submit.batches},
+                {"failed_batches", submit.failed_batches},
+                {"failed_results", submit.failed_results},
+                {"written_rows", submit.written_rows},
+                {"max_flush_us", submit.max_flush_us},
+                {"max_delay_us", submit.max_delay_us},
+                {"pending", submit.pending}
+            };
+        }
+        data["worker_queue"] = workers->queueSize();
+        json connections = json::array();
+        for (const auto& reactor : reactors) {
+            connections.push_back(reactor->connectionCount());
         }
+        data["reactor_connections"] = connections;
+        data["io_backend"] = reactors[0]->backendName();
+        data["revoked_users"] = sessions.revokedCount();
+        data["log_dropped"] = Logger::instance().droppedCount();
+        
+        return {
+            {"type", "server_stats_response"},
+            {"success", true},
+            {"data", data}
+        };
     }
     
-    json handleRegister(const json& request) {
+    json handleRegister(const RequestFields& request) {
         try {
-            std::string username = request["data"]["username"];
-            std::string password = request["data"]["password"];
-            std::string nickname = request["data"]["nickname"];
+            request.data.require({RequestField::Username, RequestField::Password, RequestField::Nickname});
+            const std::string& username = request.data.username;
+            const std::string& password = request.data.password;
+            const std::string& nickname = request.data.nickname;
             
             int user_id = 0;
-            if (db->registerUser(username, password, nickname, user_id)) {
+            bool registered;
+            {
+                DbTimer db_timer;
+                registered = db->registerUser(username, password, nickname, user_id);
+            }
+            if (registered) {
                 return {
                     {"type", "register_response"},
                     {"success", true},
@@ -963,25 +1671,23 @@ private:
         }
     }
     
-    json handleLogin(const json& request) {
+    json handleLogin(const RequestFields& request) {
         try {
-            std::string username = request["data"]["username"];
-            std::string password = request["data"]["password"];
+            request.data.require({RequestField::Username, RequestField::Password});
+            const std::string& username = request.data.username;
+            const std::string& password = request.data.password;
             
             int user_id = 0;
             std::string nickname;
             
-            if (db->loginUser(username, password, user_id, nickname)) {
-                // 创建会话
-                std::string session_id = std::to_string(user_id) + "_" + 
-                                       std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
-                
-                auto session = std::make_shared<Session>(user_id, username, nickname);
-                
-                {
-                    std::lock_guard<std::mutex> lock(sessions_mutex);
-                    sessions[session_id] = session;
-                }
+            bool authenticated;
+            {
+                DbTimer db_timer;
+                authenticated = db->loginUser(username, password, user_id, nickname);
+            }
+            if (authenticated) {
+                // 签发会话令牌，服务器不保存会话
+                std::string session_id = sessions.issue(user_id, username, nickname);
                 
                 return {
                     {"type", "login_response"},
@@ -1012,151 +1718,288 @@ private:
         }
     }
     
-    json handleGetLevelRankings(const json& request) {
+    // 注销: 该用户此前签发的令牌(包括换发的)全部失效；吊销时间写入存储，重启后和其他进程中同样生效
+    json handleLogout(const RequestFields& request) {
         try {
-            int limit = 50;
-            if (request["data"].contains("limit")) {
-                limit = request["data"]["limit"];
+            request.data.require({RequestField::SessionId});
+            Session session;
+            if (sessions.verify(request.data.session_id, session)) {
+                int64_t revoked_before_ms = sessions.revokeUser(session.user_id);
+                bool saved;
+                {
+                    DbTimer db_timer;
+                    saved = db->saveSessionRevocation(session.user_id, revoked_before_ms);
+                }
+                if (!saved) {
+                    LOG_WARN("写入会话吊销记录失败，用户{}的注销只在本进程生效", session.user_id);
+                    return {
+                        {"type", "logout_response"},
+                        {"success", false},
+                        {"error_code", "DATABASE_ERROR"},
+                        {"message", "注销失败: 无法保存注销记录"}
+                    };
+                }
             }
-            
-            json rankings = db->getLevelRankings(limit);
-            
             return {
-                {"type", "level_rankings_response"},
+                {"type", "logout_response"},
                 {"success", true},
-                {"data", rankings}
+                {"message", "已注销"}
             };
         }
         catch (const std::exception& e) {
             return {
-                {"type", "level_rankings_response"},
+                {"type", "logout_response"},
                 {"success", false},
-                {"message", "获取关卡排行榜失败: " + std::string(e.what())}
+                {"message", "注销失败: " + std::string(e.what())}
             };
         }
     }
     
-    json handleGetTimeRankings(const json& request) {
+    void refreshSessionToken(const RequestFields& request, json& response) {
+        std::string token = refreshedSessionToken(request);
+        if (!token.empty()) {
+            response["session_id"] = token;
+        }
+    }
+    
+    // 需要换发时返回新令牌，否则为空
+    std::string refreshedSessionToken(const RequestFields& request) {
+        if (!(request.data.present & RequestData::bit(RequestField::SessionId))) {
+            return std::string();
+        }
+        Session session;
+        if (sessions.verify(request.data.session_id, session) && sessions.needsRefresh(session)) {
+            return sessions.refresh(session);
+        }
+        return std::string();
+    }
+    
+    // 排行榜请求的响应帧: 热门视图直接返回快照，其他页逐行写入帧缓冲区
+    // 需要换发令牌的请求不使用共享的快照帧，和其他页一样在响应中带上新令牌
+    // 参数错误或读取数据库失败时返回错误响应帧
+    SharedFrame rankingFrame(RankingType type, const RequestFields& request, bool& success) {
+        success = false;
         try {
-            int grid_size = request["data"]["grid_size"];
-            bool used_undo = request["data"]["used_undo"];
-            int limit = 50;
-            
-            if (request["data"].contains("limit")) {
-                limit = request["data"]["limit"];
+            std::string token = refreshedSessionToken(request);
+            if (token.empty()) {
+                if (SharedFrame frame = rankingSnapshot(type, request.data)) {
+                    success = true;
+                    return frame;
+                }
             }
             
-            json rankings = db->getTimeRankings(grid_size, used_undo, limit);
-            
-            std::cout << "Returning time_rankings_response with data size: " << rankings.size() << std::endl;
-            std::cout << "JSON response: " << json({
-                {"type", "time_rankings_response"},
-                {"success", true},
-                {"data", rankings}
-            }).dump() << std::endl;
-            
-            return {
-                {"type", "time_rankings_response"},
-                {"success", true},
-                {"data", rankings}
-            };
+            // 预留空间按常用的页大小估计，更大的页由缓冲区自行扩容
+            int limit = request.data.has(RequestField::Limit) ? request.data.limit : 50;
+            JsonFrameWriter out(std::min(std::max(limit, 0), 100) * kRankingRowBytes + 128);
+            std::string next_cursor;
+            beginRankingResponse(out);
+            if (!writeRankingPage(out, type, request.data, next_cursor)) {
+                // 已写出的部分行随out丢弃
+                json response = {
+                    {"type", rankingResponseType(type)},
+                    {"success", false},
+                    {"error_code", "DATABASE_ERROR"},
+                    {"message", rankingFailurePrefix(type) + std::string("数据库错误")}
+                };
+                return encodeFrame(response.dump());
+            }
+            success = true;
+            return finishRankingResponse(out, type, next_cursor, token);
         }
         catch (const std::exception& e) {
-            std::cout << "Exception in handleGetTimeRankings: " << e.what() << std::endl;
-            return {
-                {"type", "time_rankings_response"},
+            const char* action = rankingFailurePrefix(type);
+            LOG_WARN("{}{}", action, e.what());
+            json response = {
+                {"type", rankingResponseType(type)},
                 {"success", false},
-                {"message", "获取时间排行榜失败: " + std::string(e.what())}
+                {"message", action + std::string(e.what())}
             };
+            return encodeFrame(response.dump());
+        }
+    }
+    
+    static const char* rankingFailurePrefix(RankingType type) {
+        return type == RankingType::Level ? "获取关卡排行榜失败: "
+             : type == RankingType::Time ? "获取时间排行榜失败: " : "获取步数排行榜失败: ";
+    }
+    
+    // 不带游标、limit为常用值的排行榜请求可以直接使用内存排行榜维护的快照
+    // 参数不完整时返回空，交给正常的读取路径给出错误响应
+    SharedFrame rankingSnapshot(RankingType type, const RequestData& data) {
+        if (!leaderboard.isReady() || data.hasInvalidFields() || !data.cursor.empty()) {
+            return SharedFrame();
+        }
+        
+        int limit = data.has(RequestField::Limit) ? data.limit : 50;
+        if (type != RankingType::Level &&
+            !(data.has(RequestField::GridSize) && data.has(RequestField::UsedUndo))) {
+            return SharedFrame();
+        }
+        
+        return leaderboard.snapshotFrame(type, data.grid_size, data.used_undo, limit);
+    }
+    
+    // 把一页排行榜作为JSON数组写入out，优先使用内存排行榜
+    // data中的cursor为上一页响应的next_cursor，缺省或为空时从第一名开始
+    // 参数检查在写入之前完成，抛出异常时out中没有写入任何行；读取数据库失败时返回false
+    bool writeRankingPage(JsonFrameWriter& out, RankingType type, const RequestData& data, std::string& next_cursor) {
+        int grid_size = 0;
+        bool used_undo = false;
+        if (type != RankingType::Level) {
+            data.require({RequestField::GridSize, RequestField::UsedUndo});
+            grid_size = data.grid_size;
+            used_undo = data.used_undo;
+        }
+        
+        int limit = data.has(RequestField::Limit) ? data.limit : 50;
+        
+        RankingCursor cursor;
+        const RankingCursor* after = nullptr;
+        if (data.has(RequestField::Cursor) && !data.cursor.empty()) {
+            if (!RankingCursor::decode(data.cursor, cursor)) {
+                throw std::invalid_argument("无效的分页游标");
+            }
+            after = &cursor;
+        }
+        
+        if (leaderboard.isReady()) {
+            leaderboard.writePage(out, type, grid_size, used_undo, after, limit, next_cursor);
+            return true;
+        }
+        
+        DbTimer db_timer;
+        int rows;
+        if (type == RankingType::Level) {
+            rows = db->writeLevelRankings(out, limit, after, &next_cursor);
         }
+        else if (type == RankingType::Time) {
+            rows = db->writeTimeRankings(out, grid_size, used_undo, limit, after, &next_cursor);
+        }
+        else {
+            rows = db->writeStepRankings(out, grid_size, used_undo, limit, after, &next_cursor);
+        }
+        return rows >= 0;
+    }
+    
+    json handleGetMyRank(const RequestFields& request) {
+        return rankingsAround(request, "my_rank_response", false);
     }
     
-    json handleGetStepRankings(const json& request) {
+    json handleGetRankingsAround(const RequestFields& request) {
+        return rankingsAround(request, "rankings_around_response", true);
+    }
+    
+    // 当前用户的名次以及前后各range名，名次由内存排行榜的顺序统计树计算
+    json rankingsAround(const RequestFields& request, const char* response_type, bool with_window) {
+        static const int kMaxRange = 50;
         try {
-            int grid_size = request["data"]["grid_size"];
-            bool used_undo = request["data"]["used_undo"];
-            int limit = 50;
+            const RequestData& fields = request.data;
+            fields.require({RequestField::SessionId, RequestField::GameType});
+            const std::string& game_type = fields.game_type;
+            
+            Session session;
+            if (!sessions.verify(fields.session_id, session)) {
+                return {
+                    {"type", response_type},
+                    {"success", false},
+                    {"message", "会话无效"},
+                    {"error_code", "INVALID_SESSION"}
+                };
+            }
+            int user_id = session.user_id;
+            
+            RankingType ranking_type;
+            if (!parseRankingType(game_type, ranking_type)) {
+                return {
+                    {"type", response_type},
+                    {"success", false},
+                    {"message", "无效的游戏类型"}
+                };
+            }
+            
+            if (!leaderboard.isReady()) {
+                return {
+                    {"type", response_type},
+                    {"success", false},
+                    {"message", "排行榜尚未加载，请稍后重试"}
+                };
+            }
+            
+            int grid_size = 0;
+            bool used_undo = false;
+            if (ranking_type != RankingType::Level) {
+                fields.require({RequestField::GridSize, RequestField::UsedUndo});
+                grid_size = fields.grid_size;
+                used_undo = fields.used_undo;
+            }
             
-            if (request["data"].contains("limit")) {
-                limit = request["data"]["limit"];
+            int range = 0;
+            if (with_window) {
+                range = fields.has(RequestField::Range) ? fields.range : 5;
+                range = std::max(0, std::min(range, kMaxRange));
             }
             
-            json rankings = db->getStepRankings(grid_size, used_undo, limit);
+            json data = leaderboard.aroundJson(ranking_type, grid_size, used_undo, user_id, range);
+            data["game_type"] = game_type;
+            data["grid_size"] = grid_size;
+            data["used_undo"] = used_undo;
+            if (!with_window) {
+                // 只返回自己的那一行
+                json& rankings = data["rankings"];
+                data["entry"] = rankings.empty() ? json() : rankings[0];
+                data.erase("rankings");
+                data.erase("first_rank");
+            }
             
             return {
-                {"type", "step_rankings_response"},
+                {"type", response_type},
                 {"success", true},
-                {"data", rankings}
+                {"data", data}
             };
         }
         catch (const std::exception& e) {
             return {
-                {"type", "step_rankings_response"},
+                {"type", response_type},
                 {"success", false},
-                {"message", "获取步数排行榜失败: " + std::string(e.what())}
+                {"message", "获取排名失败: " + std::string(e.what())}
             };
         }
     }
     
-    json handleSubmitGameResult(const json& request) {
+    // 解析单条成绩提交，成功时返回null；失败时返回错误响应
+    json parseSubmitGameResult(const RequestFields& request, Session& session, std::vector<GameResult>& results) {
         try {
-            int user_id = request["data"]["user_id"];
-            std::string session_id = request["data"]["session_id"];
-            std::string game_type = request["data"]["game_type"];
-            
-            // 验证会话
-            {
-                std::lock_guard<std::mutex> lock(sessions_mutex);
-                if (sessions.find(session_id) == sessions.end()) {
-                    return {
-                        {"type", "submit_result_response"},
-                        {"success", false},
-                        {"message", "会话无效"}
-                    };
-                }
-            }
-            
-            int grid_size = 0;
-            int max_level = 0;
-            int time_seconds = 0;
-            int step_count = 0;
-            bool used_undo = false;
+            const RequestData& fields = request.data;
+            fields.require({RequestField::UserId, RequestField::SessionId, RequestField::GameType});
             
-            if (game_type == "level") {
-                max_level = request["data"]["max_level"];
-            }
-            else if (game_type == "time") {
-                grid_size = request["data"]["grid_size"];
-                time_seconds = request["data"]["time_seconds"];
-                used_undo = request["data"]["used_undo"];
-            }
-            else if (game_type == "step") {
-                grid_size = request["data"]["grid_size"];
-                step_count = request["data"]["step_count"];
-                used_undo = request["data"]["used_undo"];
-            }
-            else {
+            // 验证会话，成绩只能提交到会话所属的用户
+            if (!sessions.verify(fields.session_id, session)) {
                 return {
                     {"type", "submit_result_response"},
                     {"success", false},
-                    {"message", "无效的游戏类型"}
+                    {"message", "会话无效"}
                 };
             }
-            
-            if (db->submitGameResult(user_id, game_type, grid_size, max_level, time_seconds, step_count, used_undo)) {
+            if (fields.user_id != session.user_id) {
                 return {
                     {"type", "submit_result_response"},
-                    {"success", true},
-                    {"message", "数据提交成功"}
+                    {"success", false},
+                    {"message", "用户ID与会话不符"}
                 };
             }
-            else {
+            
+            GameResult result;
+            result.user_id = session.user_id;
+            result.time = time(nullptr);
+            if (!parseGameResult(fields, result)) {
                 return {
                     {"type", "submit_result_response"},
                     {"success", false},
-                    {"message", "数据提交失败"}
+                    {"message", "无效的游戏类型"}
                 };
             }
+            results.assign(1, result);
+            return json();
         }
         catch (const std::exception& e) {
             return {
@@ -1167,50 +2010,319 @@ private:
         }
     }
     
-    void cleanupExpiredSessions() {
-        auto now = std::chrono::system_clock::now();
-        auto expire_time = std::chrono::hours(24); // 24小时过期
-        
-        std::lock_guard<std::mutex> lock(sessions_mutex);
-        auto it = sessions.begin();
-        while (it != sessions.end()) {
-            if (now - it->second->create_time > expire_time) {
-                it = sessions.erase(it);
+    // 一次提交多条成绩(例如同一局的时间和步数成绩，或离线时积攒的成绩)
+    // 会话只验证一次；全部解析成功后整组写入同一个事务，任一条无效则整组拒绝
+    json parseSubmitGameResults(const RequestFields& request, Session& session, std::vector<GameResult>& results) {
+        static const size_t kMaxResults = RequestFields::kMaxResults;
+        try {
+            request.data.require({RequestField::SessionId, RequestField::Results});
+            if (request.result_count == 0 || request.result_count > kMaxResults) {
+                return {
+                    {"type", "submit_results_response"},
+                    {"success", false},
+                    {"message", "成绩数量必须在1到" + std::to_string(kMaxResults) + "之间"}
+                };
+            }
+            
+            if (!sessions.verify(request.data.session_id, session)) {
+                return {
+                    {"type", "submit_results_response"},
+                    {"success", false},
+                    {"message", "会话无效"}
+                };
+            }
+            
+            std::time_t now = time(nullptr);
+            results.assign(request.result_count, GameResult());
+            for (size_t i = 0; i < results.size(); ++i) {
+                results[i].user_id = session.user_id;
+                results[i].time = now;
+                if (!parseGameResult(request.results[i], results[i])) {
+                    return {
+                        {"type", "submit_results_response"},
+                        {"success", false},
+                        {"message", "第" + std::to_string(i + 1) + "条成绩的游戏类型无效"}
+                    };
+                }
+            }
+            return json();
+        }
+        catch (const std::exception& e) {
+            return {
+                {"type", "submit_results_response"},
+                {"success", false},
+                {"message", "数据提交失败: " + std::string(e.what())}
+            };
+        }
+    }
+    
+    // 按game_type读取一条成绩的字段，缺少字段时抛出异常，game_type无效时返回false
+    static bool parseGameResult(const RequestData& data, GameResult& result) {
+        data.require({RequestField::GameType});
+        if (!parseRankingType(data.game_type, result.type)) {
+            return false;
+        }
+        if (result.type == RankingType::Level) {
+            data.require({RequestField::MaxLevel});
+            result.score = data.max_level;
+        }
+        else if (result.type == RankingType::Time) {
+            data.require({RequestField::GridSize, RequestField::TimeSeconds, RequestField::UsedUndo});
+            result.grid_size = data.grid_size;
+            result.score = data.time_seconds;
+            result.used_undo = data.used_undo;
+        }
+        else {
+            data.require({RequestField::GridSize, RequestField::StepCount, RequestField::UsedUndo});
+            result.grid_size = data.grid_size;
+            result.score = data.step_count;
+            result.used_undo = data.used_undo;
+        }
+        return true;
+    }
+    
+    // 成绩写入数据库后合并到内存排行榜，合并规则与数据库一致
+    void applyToLeaderboard(const GameResult& result, int row_id,
+                            const std::string& username, const std::string& nickname) {
+        RankingEntry entry;
+        entry.id = row_id;
+        entry.user_id = result.user_id;
+        entry.username = username;
+        entry.nickname = nickname;
+        entry.grid_size = result.grid_size;
+        entry.score = result.score;
+        entry.used_undo = result.used_undo;
+        entry.time = formatRankingTime(result.time);
+        leaderboard.submit(result.type, entry);
+    }
+    
+    // 监控端点只监听本机地址，供Prometheus抓取
+    bool startMetricsEndpoint() {
+        metrics_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (metrics_fd == -1) {
+            return false;
+        }
+        int opt = 1;
+        setsockopt(metrics_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(config.metrics_port);
+        if (bind(metrics_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(metrics_fd, 16) < 0 ||
+            !reactors[0]->eventLoop().addFd(metrics_fd, EPOLLIN | EPOLLET, [this](uint32_t) { acceptMetricsConnections(); })) {
+            close(metrics_fd);
+            metrics_fd = -1;
+            return false;
+        }
+        LOG_INFO("监控端点: http://127.0.0.1:{}/metrics", config.metrics_port);
+        return true;
+    }
+    
+    void acceptMetricsConnections() {
+        while (true) {
+            int fd = accept4(metrics_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                return;
+            }
+            if (!reactors[0]->eventLoop().addFd(fd, EPOLLIN | EPOLLRDHUP | EPOLLET, [this, fd](uint32_t) { readMetricsRequest(fd); })) {
+                close(fd);
+                continue;
+            }
+            metrics_requests[fd];
+        }
+    }
+    
+    // 读到完整的请求头后交给工作线程生成并写出响应，I/O线程不等待慢的抓取端
+    void readMetricsRequest(int fd) {
+        static const size_t kMaxRequestBytes = 8192;
+        auto it = metrics_requests.find(fd);
+        if (it == metrics_requests.end()) {
+            return;
+        }
+        std::string& request = it->second;
+        bool closed = false;
+        while (true) {
+            char buf[2048];
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                request.append(buf, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+        
+        bool complete = request.find("\r\n\r\n") != std::string::npos;
+        if (!complete && !closed && request.size() < kMaxRequestBytes) {
+            return;
+        }
+        
+        std::string path;
+        if (complete && request.compare(0, 4, "GET ") == 0) {
+            path = request.substr(4, request.find(' ', 4) - 4);
+        }
+        reactors[0]->eventLoop().removeFd(fd);
+        metrics_requests.erase(it);
+        if (!complete || closed) {
+            close(fd);
+            return;
+        }
+        
+        bool accepted = workers->submit([this, fd, path]() {
+            std::string body;
+            std::string status = "200 OK";
+            if (path == "/metrics") {
+                body = renderPrometheus();
             }
             else {
-                ++it;
+                status = "404 Not Found";
+                body = "not found\n";
             }
+            std::string response = "HTTP/1.1 " + status +
+                "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            
+            // 本机抓取端通常一次收完；超过1秒仍写不出去就放弃
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+            timeval timeout{1, 0};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            size_t written = 0;
+            while (written < response.size()) {
+                ssize_t n = ::send(fd, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    break;
+                }
+                written += static_cast<size_t>(n);
+            }
+            close(fd);
+        });
+        if (!accepted) {
+            close(fd);
+        }
+    }
+    
+    std::string renderPrometheus() {
+        std::string out;
+        out.reserve(64 * 1024);
+        ServerMetrics::appendPrometheus(metrics.snapshot(), out);
+        
+        DBPoolStats pool = db->getPoolStats();
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_checkouts_total", "counter", "数据库连接借出次数",
+                                    pool.checkouts);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_waits_total", "counter", "需要等待空闲连接的次数",
+                                    pool.waits);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_timeouts_total", "counter", "等待空闲连接超时次数",
+                                    pool.timeouts);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_wait_microseconds_total", "counter",
+                                    "等待空闲连接的累计时间", pool.total_wait_us);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_max_wait_microseconds", "gauge",
+                                    "最长一次等待空闲连接的时间", pool.max_wait_us);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_open_connections", "gauge", "已建立的数据库连接数",
+                                    pool.open_connections);
+        ServerMetrics::appendMetric(out, "puzzle_db_pool_idle_connections", "gauge", "空闲的数据库连接数",
+                                    pool.idle_connections);
+        UserCacheStats users = db->getUserCacheStats();
+        ServerMetrics::appendMetric(out, "puzzle_user_cache_hits_total", "counter", "登录命中用户缓存的次数",
+                                    users.hits);
+        ServerMetrics::appendMetric(out, "puzzle_user_cache_misses_total", "counter", "登录需要查询数据库的次数",
+                                    users.misses);
+        ServerMetrics::appendMetric(out, "puzzle_pending_last_logins", "gauge", "等待写入的最后登录时间",
+                                    users.pending_logins);
+        if (submit_queue) {
+            SubmitQueueStats submit = submit_queue->getStats();
+            ServerMetrics::appendMetric(out, "puzzle_submit_results_total", "counter", "进入写入队列的成绩数",
+                                        submit.submitted);
+            ServerMetrics::appendMetric(out, "puzzle_submit_batches_total", "counter", "成功提交的批次数",
+                                        submit.batches);
+            ServerMetrics::appendMetric(out, "puzzle_submit_failed_batches_total", "counter", "提交失败的批次数",
+                                        submit.failed_batches);
+            ServerMetrics::appendMetric(out, "puzzle_submit_pending", "gauge", "待写入的成绩数", submit.pending);
         }
+        ServerMetrics::appendMetric(out, "puzzle_worker_queue_depth", "gauge", "工作线程队列中的任务数",
+                                    workers->queueSize());
+        ServerMetrics::appendMetric(out, "puzzle_log_dropped_total", "counter", "队列满被丢弃的日志条数",
+                                    Logger::instance().droppedCount());
+        return out;
+    }
+    
+    // 令牌自带过期时间，这里只清理吊销表中已过期的记录
+    void cleanupExpiredSessions() {
+        sessions.pruneRevoked();
     }
 };
 
+static PuzzleGameServer* running_server = nullptr;
+
+// 部署相关的配置(存储后端、数据库账号、密钥)从环境变量读取，不写在代码里
+static void loadConfigFromEnvironment(ServerConfig& config) {
+    auto text = [](const char* name, std::string& value) {
+        if (const char* env = getenv(name)) {
+            value = env;
+        }
+    };
+    auto number = [](const char* name, int& value) {
+        if (const char* env = getenv(name)) {
+            value = atoi(env);
+        }
+    };
+    auto flag = [](const char* name, bool& value) {
+        if (const char* env = getenv(name)) {
+            value = atoi(env) != 0;
+        }
+    };
+    number("PUZZLE_PORT", config.port);
+    number("PUZZLE_REACTOR_THREADS", config.reactor_threads);
+    text("PUZZLE_IO_BACKEND", config.io_backend);
+    flag("PUZZLE_REACTOR_AFFINITY", config.reactor_cpu_affinity);
+    number("PUZZLE_WORKER_THREADS", config.worker_threads);
+    text("PUZZLE_STORAGE", config.storage_backend);
+    number("PUZZLE_SEED_USERS", config.storage_seed_users);
+    text("PUZZLE_STORAGE_PATH", config.storage_path);
+    text("PUZZLE_DB_HOST", config.db_host);
+    number("PUZZLE_DB_PORT", config.db_port);
+    text("PUZZLE_DB_USER", config.db_user);
+    text("PUZZLE_DB_PASSWORD", config.db_password);
+    text("PUZZLE_DB_NAME", config.db_name);
+    text("PUZZLE_SESSION_SECRET", config.session_secret);
+    number("PUZZLE_LEADERBOARD_RELOAD_MS", config.leaderboard_reload_ms);
+    number("PUZZLE_METRICS_PORT", config.metrics_port);
+    text("PUZZLE_LOG_LEVEL", config.log_level);
+}
+
 int main() {
     ServerConfig config;
-    config.port = 8080;
-    config.db_host = "localhost";
-    config.db_port = 3306;
-    config.db_user = "root";
-    config.db_password = "password";
-    config.db_name = "puzzle_game";
-    config.max_connections = 100;
+    loadConfigFromEnvironment(config);
     
     PuzzleGameServer server(config);
     
     if (!server.start()) {
-        std::cerr << "服务器启动失败" << std::endl;
+        LOG_ERROR("服务器启动失败");
         return 1;
     }
     
-    std::cout << "拼图游戏服务器正在运行..." << std::endl;
-    std::cout << "按 Ctrl+C 停止服务器" << std::endl;
+    LOG_INFO("拼图游戏服务器正在运行，按 Ctrl+C 停止服务器");
     
-    // 设置信号处理
+    // 对端关闭后继续写入时返回EPIPE，而不是终止进程
+    signal(SIGPIPE, SIG_IGN);
+    
+    // 设置信号处理：退出事件循环后由stop()写完队列中的成绩
+    running_server = &server;
     signal(SIGINT, [](int) {
-        std::cout << "\n正在停止服务器..." << std::endl;
-        exit(0);
+        running_server->requestStop();
     });
     
     server.run();
     
+    LOG_INFO("正在停止服务器...");
+    server.stop();
+    
     return 0;
 }
\ No newline at end of file
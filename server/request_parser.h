@@ -0,0 +1,744 @@
+#ifndef REQUEST_PARSER_H
+#define REQUEST_PARSER_H
+
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cmath>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "server_metrics.h"
+
+// 请求消息的按需解析
+// 协议消息形如 {"type": "...", "data": {...}}，处理函数只用到data中固定的几个字段。
+// 这里不构造完整的json对象: 顺序扫描一遍，把已知字段解码进RequestFields，其余值只校验语法后跳过。
+// - 字符串字段写入复用的std::string，每个工作线程一个RequestFields，容量稳定后解析不再分配内存
+// - 请求类型由编译期生成的完美哈希表查找
+// - 与nlohmann::json一样拒绝非法JSON(包括非法UTF-8和孤立的代理项)，嵌套深度有上限
+
+// 请求类型，顺序与ServerMetrics::kRequestKinds一致，枚举值即统计用的类型下标
+enum class MessageType : int {
+    Register,
+    Login,
+    Logout,
+    GetLevelRankings,
+    GetTimeRankings,
+    GetStepRankings,
+    GetMyRank,
+    GetRankingsAround,
+    SubmitGameResult,
+    SubmitGameResults,
+    ServerStats,
+    Unknown
+};
+
+static constexpr int kMessageTypeCount = static_cast<int>(MessageType::Unknown) + 1;
+static_assert(kMessageTypeCount == ServerMetrics::kKindCount, "MessageType与ServerMetrics::kRequestKinds不一致");
+
+// FNV-1a，seed用于在编译期挑选一个没有冲突的哈希函数
+constexpr uint32_t messageTypeHash(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 槽位 -> 类型下标(-1为空)
+struct MessageTypeTable {
+    static constexpr uint32_t kSlots = 32;
+    uint32_t seed;
+    int8_t slots[kSlots];
+};
+
+// 依次尝试seed，直到所有类型名落在不同槽位(完美哈希)
+constexpr MessageTypeTable buildMessageTypeTable() {
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        MessageTypeTable table{};
+        table.seed = seed;
+        for (int8_t& slot : table.slots) {
+            slot = -1;
+        }
+        bool collision = false;
+        for (int i = 0; i < ServerMetrics::kOtherKind && !collision; ++i) {
+            int8_t& slot = table.slots[messageTypeHash(ServerMetrics::kRequestKinds[i], seed) % MessageTypeTable::kSlots];
+            collision = slot != -1;
+            slot = static_cast<int8_t>(i);
+        }
+        if (!collision) {
+            return table;
+        }
+    }
+    // 找不到时不是常量表达式，编译失败
+    throw std::logic_error("找不到无冲突的消息类型哈希");
+}
+
+static constexpr MessageTypeTable kMessageTypeTable = buildMessageTypeTable();
+
+inline MessageType lookupMessageType(std::string_view name) {
+    int index = kMessageTypeTable.slots[messageTypeHash(name, kMessageTypeTable.seed) % MessageTypeTable::kSlots];
+    if (index >= 0 && name == ServerMetrics::kRequestKinds[index]) {
+        return static_cast<MessageType>(index);
+    }
+    return MessageType::Unknown;
+}
+
+// data中认识的字段
+enum class RequestField : int {
+    Username,
+    Password,
+    Nickname,
+    SessionId,
+    GameType,
+    Cursor,
+    UserId,
+    GridSize,
+    UsedUndo,
+    Limit,
+    Range,
+    MaxLevel,
+    TimeSeconds,
+    StepCount,
+    Results,
+    Count
+};
+
+enum class FieldKind { String, Int, Bool, Array };
+
+struct FieldSpec {
+    std::string_view name;
+    RequestField field;
+    FieldKind kind;
+};
+
+static constexpr FieldSpec kFieldSpecs[] = {
+    {"username", RequestField::Username, FieldKind::String},
+    {"password", RequestField::Password, FieldKind::String},
+    {"nickname", RequestField::Nickname, FieldKind::String},
+    {"session_id", RequestField::SessionId, FieldKind::String},
+    {"game_type", RequestField::GameType, FieldKind::String},
+    {"cursor", RequestField::Cursor, FieldKind::String},
+    {"user_id", RequestField::UserId, FieldKind::Int},
+    {"grid_size", RequestField::GridSize, FieldKind::Int},
+    {"used_undo", RequestField::UsedUndo, FieldKind::Bool},
+    {"limit", RequestField::Limit, FieldKind::Int},
+    {"range", RequestField::Range, FieldKind::Int},
+    {"max_level", RequestField::MaxLevel, FieldKind::Int},
+    {"time_seconds", RequestField::TimeSeconds, FieldKind::Int},
+    {"step_count", RequestField::StepCount, FieldKind::Int},
+    {"results", RequestField::Results, FieldKind::Array},
+};
+static_assert(sizeof(kFieldSpecs) / sizeof(kFieldSpecs[0]) == static_cast<size_t>(RequestField::Count),
+              "kFieldSpecs缺少字段");
+
+inline const FieldSpec* findFieldSpec(std::string_view name) {
+    for (const FieldSpec& spec : kFieldSpecs) {
+        if (spec.name == name) {
+            return &spec;
+        }
+    }
+    return nullptr;
+}
+
+// data对象(或results中的一项)解码后的字段
+// 值为null的字段视为未出现；类型不对的字段记入invalid，访问时抛出异常，处理函数转换为失败响应
+struct RequestData {
+    std::string username;
+    std::string password;
+    std::string nickname;
+    std::string session_id;
+    std::string game_type;
+    std::string cursor;
+    int user_id = 0;
+    int grid_size = 0;
+    bool used_undo = false;
+    int limit = 0;
+    int range = 0;
+    int max_level = 0;
+    int time_seconds = 0;
+    int step_count = 0;
+    uint32_t present = 0;
+    uint32_t invalid = 0;
+
+    void clear() {
+        // 保留字符串容量
+        username.clear();
+        password.clear();
+        nickname.clear();
+        session_id.clear();
+        game_type.clear();
+        cursor.clear();
+        user_id = grid_size = limit = range = max_level = time_seconds = step_count = 0;
+        used_undo = false;
+        present = invalid = 0;
+    }
+
+    static uint32_t bit(RequestField field) { return 1u << static_cast<int>(field); }
+
+    // 可选字段: 出现时类型必须正确
+    bool has(RequestField field) const {
+        if (invalid & bit(field)) {
+            throw std::invalid_argument("字段类型错误: " + std::string(fieldName(field)));
+        }
+        return (present & bit(field)) != 0;
+    }
+
+    // 必需字段: 缺失或类型不对时抛出异常
+    void require(std::initializer_list<RequestField> fields) const {
+        for (RequestField field : fields) {
+            if (!has(field)) {
+                throw std::invalid_argument("缺少字段: " + std::string(fieldName(field)));
+            }
+        }
+    }
+
+    bool hasInvalidFields() const { return invalid != 0; }
+
+    std::string* stringField(RequestField field) {
+        switch (field) {
+        case RequestField::Username: return &username;
+        case RequestField::Password: return &password;
+        case RequestField::Nickname: return &nickname;
+        case RequestField::SessionId: return &session_id;
+        case RequestField::GameType: return &game_type;
+        case RequestField::Cursor: return &cursor;
+        default: return nullptr;
+        }
+    }
+
+    int* intField(RequestField field) {
+        switch (field) {
+        case RequestField::UserId: return &user_id;
+        case RequestField::GridSize: return &grid_size;
+        case RequestField::Limit: return &limit;
+        case RequestField::Range: return &range;
+        case RequestField::MaxLevel: return &max_level;
+        case RequestField::TimeSeconds: return &time_seconds;
+        case RequestField::StepCount: return &step_count;
+        default: return nullptr;
+        }
+    }
+
+    static std::string_view fieldName(RequestField field) {
+        return kFieldSpecs[static_cast<int>(field)].name;
+    }
+};
+
+// 一条请求消息解码后的结果，由调用方复用
+struct RequestFields {
+    static constexpr size_t kMaxResults = 64;   // submit_game_results一次最多提交的成绩数
+
+    MessageType type = MessageType::Unknown;
+    std::string type_name;
+    RequestData data;
+    std::vector<RequestData> results;   // 只有前result_count项有效，最多保存kMaxResults项
+    size_t result_count = 0;            // results数组的实际长度(可能超过kMaxResults)
+
+    void clear() {
+        type = MessageType::Unknown;
+        type_name.clear();
+        data.clear();
+        result_count = 0;
+    }
+};
+
+class RequestParser {
+public:
+    // 解析message到out。不是合法JSON、顶层不是对象或缺少字符串type时返回false
+    static bool parse(std::string_view message, RequestFields& out) {
+        out.clear();
+        RequestParser parser(message, out);
+        return parser.parseMessage();
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    const char* p;
+    const char* end;
+    RequestFields& out;
+    std::string key_buffer;     // 只在键中有转义时使用
+    int depth;
+
+    RequestParser(std::string_view message, RequestFields& out)
+        : p(message.data()), end(message.data() + message.size()), out(out), depth(0) {}
+
+    bool parseMessage() {
+        bool has_type = false;
+        skipSpace();
+        bool ok = consume('{') && parseObject([this, &has_type](std::string_view key) {
+            if (key == "type") {
+                if (p < end && *p == '"') {
+                    if (!readString(out.type_name)) {
+                        return false;
+                    }
+                    has_type = true;
+                    return true;
+                }
+                has_type = false;
+                return skipValue();
+            }
+            if (key == "data") {
+                if (p < end && *p == '{') {
+                    ++p;
+                    out.data.clear();
+                    out.result_count = 0;
+                    return parseObject([this](std::string_view field) { return parseField(field, out.data, true); });
+                }
+                return skipValue();
+            }
+            return skipValue();
+        });
+        skipSpace();
+        if (!ok || p != end || !has_type) {
+            return false;
+        }
+        out.type = lookupMessageType(out.type_name);
+        return true;
+    }
+
+    // 解析data中的一个成员，p指向值的开头
+    bool parseField(std::string_view key, RequestData& data, bool allow_results) {
+        const FieldSpec* spec = findFieldSpec(key);
+        if (!spec || (spec->field == RequestField::Results && !allow_results)) {
+            return skipValue();
+        }
+        if (p >= end) {
+            return false;
+        }
+        uint32_t bit = RequestData::bit(spec->field);
+        data.present &= ~bit;
+        data.invalid &= ~bit;
+        if (*p == 'n') {
+            return parseLiteral("null");
+        }
+
+        bool matched = false;
+        switch (spec->kind) {
+        case FieldKind::String:
+            if (*p == '"') {
+                if (!readString(*data.stringField(spec->field))) {
+                    return false;
+                }
+                matched = true;
+            }
+            break;
+        case FieldKind::Int:
+            if (*p == '-' || (*p >= '0' && *p <= '9')) {
+                int64_t value = 0;
+                bool integer = false;
+                if (!parseNumber(value, integer)) {
+                    return false;
+                }
+                if (integer && value >= INT_MIN && value <= INT_MAX) {
+                    *data.intField(spec->field) = static_cast<int>(value);
+                    matched = true;
+                }
+                else {
+                    data.invalid |= bit;
+                }
+                if (!matched) {
+                    return true;
+                }
+            }
+            break;
+        case FieldKind::Bool:
+            if (*p == 't' || *p == 'f') {
+                data.used_undo = *p == 't';
+                if (!parseLiteral(data.used_undo ? "true" : "false")) {
+                    return false;
+                }
+                matched = true;
+            }
+            break;
+        case FieldKind::Array:
+            if (*p == '[') {
+                ++p;
+                if (!parseResults()) {
+                    return false;
+                }
+                matched = true;
+            }
+            break;
+        }
+
+        if (matched) {
+            data.present |= bit;
+            return true;
+        }
+        data.invalid |= bit;
+        return skipValue();
+    }
+
+    // results数组: 每一项是一条成绩，超过kMaxResults的项只计数不保存
+    bool parseResults() {
+        out.result_count = 0;
+        return parseArray([this]() {
+            size_t index = out.result_count++;
+            if (index >= RequestFields::kMaxResults || p >= end || *p != '{') {
+                if (index < RequestFields::kMaxResults) {
+                    itemAt(index).clear();
+                }
+                return skipValue();
+            }
+            ++p;
+            RequestData& item = itemAt(index);
+            item.clear();
+            return parseObject([this, &item](std::string_view field) { return parseField(field, item, false); });
+        });
+    }
+
+    RequestData& itemAt(size_t index) {
+        if (out.results.size() <= index) {
+            out.results.resize(index + 1);
+        }
+        return out.results[index];
+    }
+
+    // p指向'{'之后，每个成员调用on_member(key)，回调从值的开头开始解析
+    template <typename OnMember>
+    bool parseObject(OnMember&& on_member) {
+        if (++depth > kMaxDepth) {
+            return false;
+        }
+        skipSpace();
+        if (consume('}')) {
+            --depth;
+            return true;
+        }
+        while (true) {
+            std::string_view key;
+            if (p >= end || *p != '"' || !parseString(key_buffer, key)) {
+                return false;
+            }
+            skipSpace();
+            if (!consume(':')) {
+                return false;
+            }
+            skipSpace();
+            if (!on_member(key)) {
+                return false;
+            }
+            skipSpace();
+            if (consume(',')) {
+                skipSpace();
+                continue;
+            }
+            if (consume('}')) {
+                --depth;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    // p指向'['之后
+    template <typename OnElement>
+    bool parseArray(OnElement&& on_element) {
+        if (++depth > kMaxDepth) {
+            return false;
+        }
+        skipSpace();
+        if (consume(']')) {
+            --depth;
+            return true;
+        }
+        while (true) {
+            if (!on_element()) {
+                return false;
+            }
+            skipSpace();
+            if (consume(',')) {
+                skipSpace();
+                continue;
+            }
+            if (consume(']')) {
+                --depth;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    bool skipValue() {
+        if (p >= end) {
+            return false;
+        }
+        switch (*p) {
+        case '"': {
+            std::string_view ignored;
+            return parseString(key_buffer, ignored);
+        }
+        case '{':
+            ++p;
+            return parseObject([this](std::string_view) { return skipValue(); });
+        case '[':
+            ++p;
+            return parseArray([this]() { return skipValue(); });
+        case 't':
+            return parseLiteral("true");
+        case 'f':
+            return parseLiteral("false");
+        case 'n':
+            return parseLiteral("null");
+        default: {
+            int64_t ignored;
+            bool integer;
+            return parseNumber(ignored, integer);
+        }
+        }
+    }
+
+    bool readString(std::string& dst) {
+        std::string_view view;
+        if (!parseString(dst, view)) {
+            return false;
+        }
+        // 有转义时已经解码到dst中
+        if (view.data() != dst.data()) {
+            dst.assign(view.data(), view.size());
+        }
+        return true;
+    }
+
+    // p指向开头的引号。没有转义时view直接指向输入，否则解码到buffer，view指向buffer
+    bool parseString(std::string& buffer, std::string_view& view) {
+        ++p;
+        const char* run = p;    // 尚未复制到buffer的原样字节
+        bool escaped = false;
+        while (p < end) {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"') {
+                if (escaped) {
+                    buffer.append(run, p - run);
+                    view = buffer;
+                }
+                else {
+                    view = std::string_view(run, p - run);
+                }
+                ++p;
+                return true;
+            }
+            if (c == '\\') {
+                if (!escaped) {
+                    buffer.clear();
+                    escaped = true;
+                }
+                buffer.append(run, p - run);
+                ++p;
+                if (!parseEscape(buffer)) {
+                    return false;
+                }
+                run = p;
+            }
+            else if (c < 0x20) {
+                return false;
+            }
+            else if (c < 0x80) {
+                ++p;
+            }
+            else if (!skipUtf8()) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // p指向反斜杠之后的字符
+    bool parseEscape(std::string& buffer) {
+        if (p >= end) {
+            return false;
+        }
+        char c = *p++;
+        switch (c) {
+        case '"': buffer.push_back('"'); return true;
+        case '\\': buffer.push_back('\\'); return true;
+        case '/': buffer.push_back('/'); return true;
+        case 'b': buffer.push_back('\b'); return true;
+        case 'f': buffer.push_back('\f'); return true;
+        case 'n': buffer.push_back('\n'); return true;
+        case 'r': buffer.push_back('\r'); return true;
+        case 't': buffer.push_back('\t'); return true;
+        case 'u': break;
+        default: return false;
+        }
+
+        uint32_t code = 0;
+        if (!parseHex4(code) || (code >= 0xDC00 && code <= 0xDFFF)) {
+            return false;
+        }
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            // 代理对必须紧跟低位代理项
+            uint32_t low = 0;
+            if (end - p < 2 || p[0] != '\\' || p[1] != 'u') {
+                return false;
+            }
+            p += 2;
+            if (!parseHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                return false;
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        appendUtf8(buffer, code);
+        return true;
+    }
+
+    bool parseHex4(uint32_t& code) {
+        if (end - p < 4) {
+            return false;
+        }
+        for (int i = 0; i < 4; ++i) {
+            char c = *p++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& buffer, uint32_t code) {
+        if (code < 0x80) {
+            buffer.push_back(static_cast<char>(code));
+        }
+        else if (code < 0x800) {
+            buffer.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000) {
+            buffer.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            buffer.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else {
+            buffer.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            buffer.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    // 校验一个多字节UTF-8字符(拒绝过长编码、代理项和超过U+10FFFF的码点)
+    bool skipUtf8() {
+        unsigned char lead = static_cast<unsigned char>(*p);
+        int length;
+        uint32_t code;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+            code = lead & 0x1F;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            code = lead & 0x0F;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            code = lead & 0x07;
+        }
+        else {
+            return false;
+        }
+        if (end - p < length) {
+            return false;
+        }
+        for (int i = 1; i < length; ++i) {
+            unsigned char c = static_cast<unsigned char>(p[i]);
+            if ((c & 0xC0) != 0x80) {
+                return false;
+            }
+            code = (code << 6) | (c & 0x3F);
+        }
+        if ((length == 3 && (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))) ||
+            (length == 4 && (code < 0x10000 || code > 0x10FFFF))) {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    // 按JSON数字语法解析；integer表示没有小数和指数部分且没有溢出
+    bool parseNumber(int64_t& value, bool& integer) {
+        const char* start = p;
+        bool negative = consume('-');
+        if (p >= end || *p < '0' || *p > '9') {
+            return false;
+        }
+        uint64_t magnitude = 0;
+        bool overflow = false;
+        if (*p == '0') {
+            ++p;
+        }
+        else {
+            while (p < end && *p >= '0' && *p <= '9') {
+                uint64_t digit = static_cast<uint64_t>(*p - '0');
+                overflow = overflow || magnitude > (static_cast<uint64_t>(INT64_MAX) - digit) / 10;
+                magnitude = magnitude * 10 + digit;
+                ++p;
+            }
+        }
+        integer = !overflow;
+        if (consume('.')) {
+            integer = false;
+            if (!skipDigits()) {
+                return false;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            integer = false;
+            if (p < end && (*p == '+' || *p == '-')) {
+                ++p;
+            }
+            if (!skipDigits()) {
+                return false;
+            }
+        }
+        value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        // 与nlohmann::json一致，超出double范围的数字视为非法
+        return integer || isFiniteNumber(start, p);
+    }
+
+    bool isFiniteNumber(const char* start, const char* stop) {
+        key_buffer.assign(start, stop);
+        return std::isfinite(strtod(key_buffer.c_str(), nullptr));
+    }
+
+    bool skipDigits() {
+        const char* start = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        return p != start;
+    }
+
+    bool parseLiteral(std::string_view literal) {
+        if (static_cast<size_t>(end - p) < literal.size() || memcmp(p, literal.data(), literal.size()) != 0) {
+            return false;
+        }
+        p += literal.size();
+        return true;
+    }
+
+    bool consume(char c) {
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    }
+};
+
+#endif // REQUEST_PARSER_H
@@ -0,0 +1,45 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <string>
+#include <stddef.h>
+
+// 服务器配置
+struct ServerConfig {
+    int port = 8080;
+    std::string storage_backend = "mysql"; // 存储后端: "mysql"、本地日志+快照"log"，或不需要数据库实例的"memory"
+    int storage_seed_users = 0;      // memory后端(或空目录的log后端)启动时生成的确定性测试用户数
+    std::string storage_path = "puzzle_data"; // log后端的数据目录
+    size_t storage_compact_bytes = 64 * 1024 * 1024; // log后端日志超过该大小时写快照并切换日志
+    bool storage_sync = true;        // log后端组提交时fdatasync；false时只写入页缓存，宕机可能丢最近的写入
+    std::string db_host = "localhost";
+    int db_port = 3306;
+    std::string db_user = "puzzle_admin";
+    std::string db_password = "123456";
+    std::string db_name = "puzzle_game";
+    int max_connections = 100;
+    size_t output_high_water_mark = 1024 * 1024; // 单连接发送队列高水位(字节)，超过后暂停读取该连接
+    int reactor_threads = 1;         // I/O线程数，每个线程一个SO_REUSEPORT监听socket和自己的连接
+    bool reactor_cpu_affinity = false; // 把第i个I/O线程绑定到第i个CPU
+    std::string io_backend = "epoll"; // 网络后端: epoll 或 io_uring(不可用时回退到epoll)
+    int worker_threads = 4;          // 请求处理线程数
+    int worker_queue_depth = 1024;   // 工作线程任务队列上限，队列满时返回SERVER_BUSY
+    int db_pool_size = 8;            // MySQL连接池上限
+    int db_pool_timeout_ms = 3000;   // 等待空闲连接的最长时间
+    int db_validate_idle_ms = 30000; // 空闲超过该时间的连接借出前先mysql_ping
+    int session_timeout_seconds = 24 * 3600; // 会话令牌有效期，过去一半后随响应换发新令牌
+    std::string session_secret;      // 会话令牌的HMAC密钥，多个服务器进程需相同；为空时启动时随机生成
+    int session_revocation_poll_ms = 2000; // 每隔这么久从存储读取其他进程的注销，0表示只在启动时读取
+    int leaderboard_reload_ms = 0;   // 每隔这么久把数据库中的排行榜合并到内存，多个进程共享同一MySQL时需要设置；0表示只在启动时加载
+    bool submit_write_behind = true; // 成绩入队后批量写库，提交后再响应；false时每次提交同步写库
+    int submit_flush_interval_ms = 5;   // 成绩入队后最多等待多久提交
+    size_t submit_batch_rows = 256;     // 攒够这么多条成绩立即提交
+    size_t submit_queue_limit = 65536;  // 待写入成绩上限，超过后返回SERVER_BUSY
+    size_t user_cache_size = 10000;  // MySQL后端缓存的登录记录数(LRU)，0表示每次登录都查询数据库
+    int user_cache_ttl_seconds = 300; // 缓存的登录记录多久后重新查询数据库，0表示不过期
+    int last_login_flush_ms = 5000;  // 最后登录时间先记在内存中，每隔这么久批量写入数据库
+    int metrics_port = 0;            // 大于0时在127.0.0.1上提供Prometheus文本格式的/metrics
+    std::string log_level = "info";  // 运行时日志级别: debug、info、warn、error；低于编译期LOG_MIN_LEVEL的日志语句已被删除
+};
+
+#endif // SERVER_CONFIG_H
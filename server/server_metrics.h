@@ -0,0 +1,413 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <nlohmann/json.hpp>
+
+// HDR风格的对数线性延迟直方图(微秒)
+// 16微秒以下每微秒一格，之后每个2的幂区间分为16格，相对误差不超过1/16；超过约134秒的值计入最后一格
+struct LatencyHistogram {
+    static constexpr int kSubBuckets = 16;
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kMaxMagnitude = 27;
+    static constexpr int kBuckets = kSubBuckets * (kMaxMagnitude - kSubBucketBits + 1);
+
+    std::array<uint64_t, kBuckets> counts{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    static int bucketIndex(uint64_t us) {
+        if (us < kSubBuckets) {
+            return static_cast<int>(us);
+        }
+        int magnitude = 63 - __builtin_clzll(us);
+        if (magnitude >= kMaxMagnitude) {
+            return kBuckets - 1;
+        }
+        int shift = magnitude - kSubBucketBits;
+        return kSubBuckets * (shift + 1) + static_cast<int>((us >> shift) - kSubBuckets);
+    }
+
+    // 格子内的最大值，百分位按它报告，不会低估
+    static uint64_t bucketUpper(int index) {
+        if (index < kSubBuckets) {
+            return static_cast<uint64_t>(index);
+        }
+        int shift = index / kSubBuckets - 1;
+        uint64_t sub = static_cast<uint64_t>(index % kSubBuckets);
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    uint64_t percentile(double q) const {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen >= target) {
+                return std::min(bucketUpper(i), max);
+            }
+        }
+        return max;
+    }
+
+    nlohmann::json toJson() const {
+        return {
+            {"count", count},
+            {"avg", count ? sum / count : 0},
+            {"p50", percentile(0.5)},
+            {"p90", percentile(0.9)},
+            {"p99", percentile(0.99)},
+            {"p999", percentile(0.999)},
+            {"max", max}
+        };
+    }
+};
+
+// 请求处理的各阶段
+enum class RequestPhase : int {
+    Queue,      // 从I/O线程分发到工作线程开始执行
+    Parse,      // JSON解析
+    Handler,    // 处理函数，不含数据库访问
+    Db,         // 数据库访问(借出连接+查询)；批量写入的成绩为入队到所在批次提交
+    Serialize,  // 响应序列化
+    Total,      // 以上之和
+    Count
+};
+
+// 服务器级计数器
+enum class ServerCounter : int {
+    ConnectionsAccepted,
+    ConnectionsClosed,
+    BytesReceived,
+    BytesSent,
+    BusyRejections,     // 工作线程队列已满被拒绝的请求
+    IoSyscalls,         // I/O线程收发网络数据的系统调用(epoll_wait/accept/recv/writev，或io_uring_enter)
+    Count
+};
+
+// 一次请求的计时结果，单位微秒
+struct RequestTiming {
+    int kind = 0;
+    bool success = false;
+    uint64_t queue_us = 0;
+    uint64_t parse_us = 0;
+    uint64_t handler_us = 0;
+    uint64_t db_us = 0;
+    uint64_t serialize_us = 0;
+};
+
+// 统计工作线程中数据库调用的耗时: 用作用域包住每次Database调用，耗时累加到当前线程，
+// 处理函数返回后由take()取出记入RequestTiming::db_us
+class DbTimer {
+public:
+    DbTimer() : started(std::chrono::steady_clock::now()) {}
+
+    ~DbTimer() {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        elapsed() += us > 0 ? static_cast<uint64_t>(us) : 0;
+    }
+
+    DbTimer(const DbTimer&) = delete;
+    DbTimer& operator=(const DbTimer&) = delete;
+
+    // 取出并清零当前线程累计的耗时
+    static uint64_t take() {
+        uint64_t us = elapsed();
+        elapsed() = 0;
+        return us;
+    }
+
+private:
+    std::chrono::steady_clock::time_point started;
+
+    static uint64_t& elapsed() {
+        thread_local uint64_t us = 0;
+        return us;
+    }
+};
+
+// 服务器运行指标
+// - 每个线程第一次记录时分配自己的指标块，之后只由该线程写入: 普通的load+store，没有锁和原子读改写
+// - 读取时加锁遍历所有指标块求和，线程退出后它的指标块保留，计数不会丢失
+// - 读取与写入并发时结果可能相差正在进行的几次记录，对监控没有影响
+class ServerMetrics {
+public:
+    static constexpr int kPhaseCount = static_cast<int>(RequestPhase::Count);
+    static constexpr int kCounterCount = static_cast<int>(ServerCounter::Count);
+
+    // 按请求类型分别统计，未知类型和无法解析的请求计入other
+    static constexpr const char* kRequestKinds[] = {
+        "register", "login", "logout",
+        "get_level_rankings", "get_time_rankings", "get_step_rankings",
+        "get_my_rank", "get_rankings_around",
+        "submit_game_result", "submit_game_results",
+        "server_stats", "other"
+    };
+    static constexpr int kKindCount = sizeof(kRequestKinds) / sizeof(kRequestKinds[0]);
+    static constexpr int kOtherKind = kKindCount - 1;
+
+    static constexpr const char* kPhaseNames[] = {"queue", "parse", "handler", "db", "serialize", "total"};
+
+    // 合并后的指标
+    struct Snapshot {
+        std::array<uint64_t, kCounterCount> counters{};
+        std::array<uint64_t, kKindCount> requests{};
+        std::array<uint64_t, kKindCount> errors{};
+        std::vector<LatencyHistogram> latency;  // [kind * kPhaseCount + phase]
+        double uptime_seconds = 0;
+
+        const LatencyHistogram& histogram(int kind, RequestPhase phase) const {
+            return latency[kind * kPhaseCount + static_cast<int>(phase)];
+        }
+    };
+
+    ServerMetrics() : instance_id(nextInstanceId()), started(std::chrono::steady_clock::now()) {}
+
+    ServerMetrics(const ServerMetrics&) = delete;
+    ServerMetrics& operator=(const ServerMetrics&) = delete;
+
+    void add(ServerCounter counter, uint64_t n = 1) {
+        bump(local().counters[static_cast<int>(counter)], n);
+    }
+
+    void recordRequest(const RequestTiming& timing) {
+        ThreadBlock& block = local();
+        int kind = std::max(0, std::min(timing.kind, kOtherKind));
+        bump(block.requests[kind], 1);
+        if (!timing.success) {
+            bump(block.errors[kind], 1);
+        }
+        HistogramCells* cells = &block.latency[kind * kPhaseCount];
+        record(cells[static_cast<int>(RequestPhase::Queue)], timing.queue_us);
+        record(cells[static_cast<int>(RequestPhase::Parse)], timing.parse_us);
+        record(cells[static_cast<int>(RequestPhase::Handler)], timing.handler_us);
+        record(cells[static_cast<int>(RequestPhase::Db)], timing.db_us);
+        record(cells[static_cast<int>(RequestPhase::Serialize)], timing.serialize_us);
+        record(cells[static_cast<int>(RequestPhase::Total)],
+               timing.queue_us + timing.parse_us + timing.handler_us + timing.db_us + timing.serialize_us);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot result;
+        result.latency.resize(kKindCount * kPhaseCount);
+        result.uptime_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::lock_guard<std::mutex> lock(blocks_mutex);
+        for (const auto& block : blocks) {
+            for (int i = 0; i < kCounterCount; ++i) {
+                result.counters[i] += block->counters[i].load(std::memory_order_relaxed);
+            }
+            for (int i = 0; i < kKindCount; ++i) {
+                result.requests[i] += block->requests[i].load(std::memory_order_relaxed);
+                result.errors[i] += block->errors[i].load(std::memory_order_relaxed);
+            }
+            for (int i = 0; i < kKindCount * kPhaseCount; ++i) {
+                merge(block->latency[i], result.latency[i]);
+            }
+        }
+        return result;
+    }
+
+    // server_stats响应中的请求和连接部分
+    static nlohmann::json toJson(const Snapshot& snap) {
+        nlohmann::json requests = nlohmann::json::object();
+        for (int kind = 0; kind < kKindCount; ++kind) {
+            if (snap.requests[kind] == 0) {
+                continue;
+            }
+            nlohmann::json entry = {
+                {"count", snap.requests[kind]},
+                {"errors", snap.errors[kind]}
+            };
+            for (int phase = 0; phase < kPhaseCount; ++phase) {
+                entry[kPhaseNames[phase]] = snap.histogram(kind, static_cast<RequestPhase>(phase)).toJson();
+            }
+            requests[kRequestKinds[kind]] = entry;
+        }
+
+        uint64_t accepted = counter(snap, ServerCounter::ConnectionsAccepted);
+        uint64_t closed = counter(snap, ServerCounter::ConnectionsClosed);
+        return {
+            {"uptime_seconds", static_cast<uint64_t>(snap.uptime_seconds)},
+            {"connections", {
+                {"accepted", accepted},
+                {"active", accepted - std::min(accepted, closed)}
+            }},
+            {"bytes", {
+                {"received", counter(snap, ServerCounter::BytesReceived)},
+                {"sent", counter(snap, ServerCounter::BytesSent)}
+            }},
+            {"busy_rejections", counter(snap, ServerCounter::BusyRejections)},
+            {"io_syscalls", counter(snap, ServerCounter::IoSyscalls)},
+            {"requests", requests}
+        };
+    }
+
+    // Prometheus文本格式，延迟按summary输出
+    static void appendPrometheus(const Snapshot& snap, std::string& out) {
+        uint64_t accepted = counter(snap, ServerCounter::ConnectionsAccepted);
+        uint64_t closed = counter(snap, ServerCounter::ConnectionsClosed);
+        appendMetric(out, "puzzle_uptime_seconds", "gauge", "进程运行时间", snap.uptime_seconds);
+        appendMetric(out, "puzzle_connections_accepted_total", "counter", "累计接受的连接数", accepted);
+        appendMetric(out, "puzzle_connections_active", "gauge", "当前连接数", accepted - std::min(accepted, closed));
+        appendMetric(out, "puzzle_bytes_received_total", "counter", "累计接收字节数",
+                     counter(snap, ServerCounter::BytesReceived));
+        appendMetric(out, "puzzle_bytes_sent_total", "counter", "累计发送字节数",
+                     counter(snap, ServerCounter::BytesSent));
+        appendMetric(out, "puzzle_busy_rejections_total", "counter", "工作队列已满被拒绝的请求数",
+                     counter(snap, ServerCounter::BusyRejections));
+        appendMetric(out, "puzzle_io_syscalls_total", "counter", "I/O线程收发网络数据的系统调用次数",
+                     counter(snap, ServerCounter::IoSyscalls));
+
+        out += "# HELP puzzle_requests_total 按类型统计的请求数\n# TYPE puzzle_requests_total counter\n";
+        for (int kind = 0; kind < kKindCount; ++kind) {
+            appendSample(out, "puzzle_requests_total", kind, nullptr, nullptr, snap.requests[kind]);
+        }
+        out += "# HELP puzzle_request_errors_total 失败的请求数\n# TYPE puzzle_request_errors_total counter\n";
+        for (int kind = 0; kind < kKindCount; ++kind) {
+            appendSample(out, "puzzle_request_errors_total", kind, nullptr, nullptr, snap.errors[kind]);
+        }
+
+        static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        static const char* const quantile_names[] = {"0.5", "0.9", "0.99", "0.999"};
+        out += "# HELP puzzle_request_latency_microseconds 请求各阶段耗时\n"
+               "# TYPE puzzle_request_latency_microseconds summary\n";
+        for (int kind = 0; kind < kKindCount; ++kind) {
+            if (snap.requests[kind] == 0) {
+                continue;
+            }
+            for (int phase = 0; phase < kPhaseCount; ++phase) {
+                const LatencyHistogram& h = snap.histogram(kind, static_cast<RequestPhase>(phase));
+                for (int q = 0; q < 4; ++q) {
+                    appendSample(out, "puzzle_request_latency_microseconds", kind, kPhaseNames[phase],
+                                 quantile_names[q], static_cast<double>(h.percentile(quantiles[q])));
+                }
+                appendSample(out, "puzzle_request_latency_microseconds_sum", kind, kPhaseNames[phase],
+                             nullptr, static_cast<double>(h.sum));
+                appendSample(out, "puzzle_request_latency_microseconds_count", kind, kPhaseNames[phase],
+                             nullptr, static_cast<double>(h.count));
+            }
+        }
+    }
+
+    static void appendMetric(std::string& out, const char* name, const char* type,
+                             const char* help, double value) {
+        char line[256];
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %.15g\n",
+                 name, help, name, type, name, value);
+        out += line;
+    }
+
+private:
+    // 只由所属线程写入的直方图
+    struct HistogramCells {
+        std::atomic<uint64_t> counts[LatencyHistogram::kBuckets];
+        std::atomic<uint64_t> sum;
+        std::atomic<uint64_t> max;
+    };
+
+    struct alignas(64) ThreadBlock {
+        std::thread::id owner;
+        std::atomic<uint64_t> counters[kCounterCount];
+        std::atomic<uint64_t> requests[kKindCount];
+        std::atomic<uint64_t> errors[kKindCount];
+        HistogramCells latency[kKindCount * kPhaseCount];
+    };
+
+    uint64_t instance_id;
+    std::chrono::steady_clock::time_point started;
+    mutable std::mutex blocks_mutex;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+
+    static uint64_t nextInstanceId() {
+        static std::atomic<uint64_t> next(1);
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 当前线程的指标块，只有每个线程第一次记录时加锁
+    ThreadBlock& local() {
+        thread_local uint64_t cached_id = 0;
+        thread_local ThreadBlock* cached_block = nullptr;
+        if (cached_id == instance_id) {
+            return *cached_block;
+        }
+
+        std::thread::id self = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(blocks_mutex);
+        ThreadBlock* block = nullptr;
+        for (const auto& existing : blocks) {
+            if (existing->owner == self) {
+                block = existing.get();
+                break;
+            }
+        }
+        if (!block) {
+            blocks.push_back(std::unique_ptr<ThreadBlock>(new ThreadBlock()));
+            block = blocks.back().get();
+            block->owner = self;
+        }
+        cached_id = instance_id;
+        cached_block = block;
+        return *block;
+    }
+
+    // 单写者计数器: 不需要lock前缀的读改写指令
+    static void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+        cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void record(HistogramCells& cells, uint64_t us) {
+        bump(cells.counts[LatencyHistogram::bucketIndex(us)], 1);
+        bump(cells.sum, us);
+        if (us > cells.max.load(std::memory_order_relaxed)) {
+            cells.max.store(us, std::memory_order_relaxed);
+        }
+    }
+
+    static void merge(const HistogramCells& cells, LatencyHistogram& out) {
+        for (int i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            uint64_t n = cells.counts[i].load(std::memory_order_relaxed);
+            out.counts[i] += n;
+            out.count += n;
+        }
+        out.sum += cells.sum.load(std::memory_order_relaxed);
+        out.max = std::max(out.max, cells.max.load(std::memory_order_relaxed));
+    }
+
+    static uint64_t counter(const Snapshot& snap, ServerCounter which) {
+        return snap.counters[static_cast<int>(which)];
+    }
+
+    static void appendSample(std::string& out, const char* name, int kind, const char* phase,
+                             const char* quantile, double value) {
+        char line[256];
+        int n = snprintf(line, sizeof(line), "%s{type=\"%s\"", name, kRequestKinds[kind]);
+        if (phase) {
+            n += snprintf(line + n, sizeof(line) - n, ",phase=\"%s\"", phase);
+        }
+        if (quantile) {
+            n += snprintf(line + n, sizeof(line) - n, ",quantile=\"%s\"", quantile);
+        }
+        snprintf(line + n, sizeof(line) - n, "} %.15g\n", value);
+        out += line;
+    }
+};
+
+#endif // SERVER_METRICS_H
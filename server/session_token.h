@@ -0,0 +1,258 @@
+#ifndef SESSION_TOKEN_H
+#define SESSION_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+#include <nlohmann/json.hpp>
+
+// 已验证的会话，全部信息来自令牌本身
+struct Session {
+    int user_id = 0;
+    std::string username;
+    std::string nickname;
+    int64_t issued_at_ms = 0;   // Unix时间(毫秒)，与用户的吊销时间比较
+    int64_t expires_at = 0;     // Unix时间(秒)
+    uint64_t token_id = 0;      // 随机值，同一毫秒内签发的令牌也各不相同
+};
+
+// 无状态会话令牌: base64url(JSON载荷) + "." + base64url(HMAC-SHA256(载荷))
+// - 载荷包含用户id、用户名、昵称、签发和过期时间，验证只需要密钥，不查会话表
+// - 使用相同密钥的多个服务器进程可以各自验证，进程重启后令牌仍然有效
+// - 注销按用户吊销: 记录注销时间，该用户在此之前签发的令牌(包括换发过的每一代)全部失效；
+//   记录保留到注销前签发的令牌全部过期为止
+// - 吊销记录由调用方写入存储并定期读回(applyRevocation)，重启后和使用同一数据库的其他进程中同样生效
+class SessionTokens {
+public:
+    SessionTokens(const std::string& secret, std::chrono::seconds lifetime)
+        : key(secret), lifetime(lifetime.count()), revoked_count(0) {
+        if (key.empty()) {
+            // 没有配置密钥时随机生成，只在本进程内有效
+            unsigned char random[32];
+            if (RAND_bytes(random, sizeof(random)) != 1) {
+                throw std::runtime_error("生成会话密钥失败");
+            }
+            key.assign(reinterpret_cast<char*>(random), sizeof(random));
+        }
+    }
+
+    SessionTokens(const SessionTokens&) = delete;
+    SessionTokens& operator=(const SessionTokens&) = delete;
+
+    std::string issue(int user_id, const std::string& username, const std::string& nickname) const {
+        uint64_t token_id = 0;
+        if (RAND_bytes(reinterpret_cast<unsigned char*>(&token_id), sizeof(token_id)) != 1) {
+            throw std::runtime_error("生成会话令牌失败");
+        }
+        int64_t now_ms = nowMillis();
+        nlohmann::json payload = {
+            {"uid", user_id},
+            {"usr", username},
+            {"nick", nickname},
+            {"iat", now_ms},
+            {"exp", now_ms / 1000 + lifetime},
+            {"jti", token_id}
+        };
+        std::string body = base64UrlEncode(payload.dump());
+        return body + "." + base64UrlEncode(sign(body));
+    }
+
+    // 校验签名、过期时间和吊销表，成功时填充session
+    bool verify(const std::string& token, Session& session) const {
+        size_t dot = token.find('.');
+        if (dot == std::string::npos || dot == 0) {
+            return false;
+        }
+        std::string body = token.substr(0, dot);
+        std::string mac;
+        if (!base64UrlDecode(token.substr(dot + 1), mac)) {
+            return false;
+        }
+        std::string expected = sign(body);
+        if (mac.size() != expected.size() ||
+            CRYPTO_memcmp(mac.data(), expected.data(), expected.size()) != 0) {
+            return false;
+        }
+
+        std::string text;
+        if (!base64UrlDecode(body, text)) {
+            return false;
+        }
+        nlohmann::json payload = nlohmann::json::parse(text, nullptr, false);
+        if (!payload.is_object()) {
+            return false;
+        }
+        try {
+            session.user_id = payload.at("uid");
+            session.username = payload.at("usr");
+            session.nickname = payload.at("nick");
+            session.issued_at_ms = payload.at("iat");
+            session.expires_at = payload.at("exp");
+            session.token_id = payload.at("jti");
+        }
+        catch (const nlohmann::json::exception&) {
+            return false;
+        }
+        if (session.expires_at <= nowSeconds()) {
+            return false;
+        }
+        return !isRevoked(session.user_id, session.issued_at_ms);
+    }
+
+    // 已过去一半有效期的令牌应换成新令牌，活跃用户不会因固定的过期时间被登出
+    bool needsRefresh(const Session& session) const {
+        return session.expires_at - nowSeconds() < lifetime / 2;
+    }
+
+    std::string refresh(const Session& session) const {
+        return issue(session.user_id, session.username, session.nickname);
+    }
+
+    // 注销用户的全部会话，返回吊销时间(毫秒)，调用方把它写入存储
+    // 此时刻及之前签发的令牌失效，之后重新登录得到的令牌不受影响
+    int64_t revokeUser(int user_id) {
+        int64_t revoked_before = nowMillis();
+        applyRevocation(user_id, revoked_before);
+        return revoked_before;
+    }
+
+    // 应用一条吊销记录(本进程的注销，或从存储读回的其他进程、重启前的注销)，较早的记录被忽略
+    // 注销前签发的令牌都已过期的记录直接丢弃
+    void applyRevocation(int user_id, int64_t revoked_before_ms) {
+        int64_t expires_ms = revoked_before_ms + lifetime * 1000;
+        if (expires_ms <= nowMillis()) {
+            return;
+        }
+        std::unique_lock<std::shared_mutex> lock(revoked_mutex);
+        int64_t& current = revoked[user_id];
+        if (revoked_before_ms > current) {
+            current = revoked_before_ms;
+            expiry_order.push(std::make_pair(expires_ms, user_id));
+            revoked_count.store(revoked.size(), std::memory_order_release);
+        }
+    }
+
+    // 删除注销前签发的令牌都已过期的记录，由定时器周期调用，代价与删除数量成正比
+    size_t pruneRevoked() {
+        if (revoked_count.load(std::memory_order_acquire) == 0) {
+            return 0;
+        }
+        int64_t now_ms = nowMillis();
+        size_t pruned = 0;
+        std::unique_lock<std::shared_mutex> lock(revoked_mutex);
+        while (!expiry_order.empty() && expiry_order.top().first <= now_ms) {
+            int user_id = expiry_order.top().second;
+            expiry_order.pop();
+            // 之后又注销过的用户还有更晚的记录在队列中
+            auto it = revoked.find(user_id);
+            if (it != revoked.end() && it->second + lifetime * 1000 <= now_ms) {
+                revoked.erase(it);
+                ++pruned;
+            }
+        }
+        revoked_count.store(revoked.size(), std::memory_order_release);
+        return pruned;
+    }
+
+    // 令牌有效期(秒)，读取存储中的吊销记录时只需要这段时间内的
+    int64_t lifetimeSeconds() const { return lifetime; }
+
+    size_t revokedCount() const {
+        return revoked_count.load(std::memory_order_acquire);
+    }
+
+private:
+    using ExpiryEntry = std::pair<int64_t, int>;   // (可以删除的时间(毫秒), user_id)
+
+    std::string key;
+    int64_t lifetime;   // 秒
+    mutable std::shared_mutex revoked_mutex;
+    std::unordered_map<int, int64_t> revoked;   // user_id -> 吊销时间(毫秒)，之前签发的令牌无效
+    std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, std::greater<ExpiryEntry>> expiry_order;
+    std::atomic<size_t> revoked_count;   // 吊销表为空时验证不加锁
+
+    static int64_t nowSeconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    bool isRevoked(int user_id, int64_t issued_at_ms) const {
+        if (revoked_count.load(std::memory_order_acquire) == 0) {
+            return false;
+        }
+        std::shared_lock<std::shared_mutex> lock(revoked_mutex);
+        auto it = revoked.find(user_id);
+        return it != revoked.end() && issued_at_ms <= it->second;
+    }
+
+    std::string sign(const std::string& data) const {
+        unsigned char mac[EVP_MAX_MD_SIZE];
+        unsigned int mac_len = 0;
+        HMAC(EVP_sha256(), key.data(), static_cast<int>(key.size()),
+             reinterpret_cast<const unsigned char*>(data.data()), data.size(), mac, &mac_len);
+        return std::string(reinterpret_cast<char*>(mac), mac_len);
+    }
+
+    static std::string base64UrlEncode(const std::string& data) {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        std::string out;
+        out.reserve((data.size() + 2) / 3 * 4);
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (unsigned char c : data) {
+            buffer = (buffer << 8) | c;
+            bits += 8;
+            while (bits >= 6) {
+                bits -= 6;
+                out += table[(buffer >> bits) & 0x3F];
+            }
+        }
+        if (bits > 0) {
+            out += table[(buffer << (6 - bits)) & 0x3F];
+        }
+        return out;
+    }
+
+    static bool base64UrlDecode(const std::string& text, std::string& out) {
+        out.clear();
+        out.reserve(text.size() * 3 / 4);
+        uint32_t buffer = 0;
+        int bits = 0;
+        for (char c : text) {
+            int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '-') value = 62;
+            else if (c == '_') value = 63;
+            else return false;
+            buffer = (buffer << 6) | static_cast<uint32_t>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out += static_cast<char>((buffer >> bits) & 0xFF);
+            }
+        }
+        return true;
+    }
+};
+
+#endif // SESSION_TOKEN_H
@@ -0,0 +1,270 @@
+#ifndef SUBMIT_QUEUE_H
+#define SUBMIT_QUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "database.h"
+#include "logger.h"
+
+// 成绩写入队列统计信息
+struct SubmitQueueStats {
+    uint64_t submitted = 0;         // 入队的成绩数
+    uint64_t rejected = 0;          // 队列已满被拒绝的成绩数
+    uint64_t written_rows = 0;      // 合并后实际写入的行数
+    uint64_t batches = 0;           // 成功提交的批次数
+    uint64_t failed_batches = 0;    // 提交失败的次数(每次重试都计入)
+    uint64_t failed_results = 0;    // 重试后仍无法写入、以失败答复的成绩数
+    uint64_t max_batch = 0;         // 最大批次(合并前的成绩数)
+    uint64_t total_flush_us = 0;    // 累计事务耗时(微秒)
+    uint64_t max_flush_us = 0;      // 最长一次事务耗时(微秒)
+    uint64_t max_delay_us = 0;      // 成绩从入队到提交完成的最长时间(微秒)
+    std::array<uint64_t, 10> batch_sizes{};  // 批次大小分布: 第i格为[2^i, 2^(i+1))，最后一格为512及以上
+    size_t pending = 0;             // 当前待写入的成绩数
+};
+
+// 游戏成绩的后台批量写入(group commit)
+// - submit把成绩和完成回调放入队列就返回，工作线程不阻塞在数据库提交上
+// - 写入线程从第一条成绩入队起最多等flush_interval，或攒够batch_rows条立即提交
+// - 同一批中同一用户同一排行榜的多条成绩先合并，再用一个事务写入
+// - 事务提交后才调用该批各组成绩的完成回调，调用方据此确认请求，不会确认尚未持久化的成绩
+// - 提交失败时整批保留，退避后与新成绩一起重试；连续kMaxAttempts次失败或停止时仍写不进去，
+//   以失败调用回调并丢弃这一批，成绩不会无限期地留在内存中
+class SubmitQueue {
+public:
+    // 一组成绩写入完成时在写入线程中调用一次，committed为false表示最终写入失败
+    using Completion = std::function<void(bool committed)>;
+
+    SubmitQueue(Database& db, int flush_interval_ms, size_t batch_rows, size_t max_pending)
+        : db(db), flush_interval(std::max(0, flush_interval_ms)),
+          batch_rows(std::max<size_t>(1, batch_rows)), max_pending(max_pending), stopping(false) {
+        writer = std::thread([this]() { run(); });
+    }
+
+    ~SubmitQueue() {
+        shutdown();
+    }
+
+    SubmitQueue(const SubmitQueue&) = delete;
+    SubmitQueue& operator=(const SubmitQueue&) = delete;
+
+    // 队列已满或已停止时返回false，此时不会调用done
+    bool submit(const GameResult& result, Completion done) {
+        return submit(std::vector<GameResult>(1, result), std::move(done));
+    }
+
+    // 一组成绩整体入队，保证在同一个事务中写入；放不下时整组拒绝
+    bool submit(const std::vector<GameResult>& results, Completion done) {
+        if (results.empty()) {
+            done(true);
+            return true;
+        }
+        bool wake = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || pending.size() + results.size() > max_pending) {
+                stats.rejected += results.size();
+                return false;
+            }
+            auto now = std::chrono::steady_clock::now();
+            size_t old_size = pending.size();
+            for (const GameResult& result : results) {
+                pending.push_back({result, now, false, Completion()});
+            }
+            pending.back().group_end = true;
+            pending.back().done = std::move(done);
+            stats.submitted += results.size();
+            // 只在队列从空变为非空或攒满一批时唤醒写入线程
+            wake = old_size == 0 || (old_size < batch_rows && pending.size() >= batch_rows);
+        }
+        if (wake) {
+            cond.notify_one();
+        }
+        return true;
+    }
+
+    // 停止接收新成绩，等待已入队的成绩写完(或最终失败)，所有回调都已调用后返回
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            stopping = true;
+        }
+        cond.notify_one();
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    SubmitQueueStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        SubmitQueueStats result = stats;
+        result.pending = pending.size() + batch.size();
+        return result;
+    }
+
+private:
+    struct Pending {
+        GameResult result;
+        std::chrono::steady_clock::time_point queued_at;
+        bool group_end;     // 一组成绩的最后一条，批次只在组边界切分
+        Completion done;    // 只有组的最后一条带回调
+    };
+
+    static constexpr int kMinRetryMs = 100;
+    static constexpr int kMaxRetryMs = 1000;
+    static constexpr int kMaxAttempts = 3;  // 同一批最多提交的次数，客户端在等待响应，不能无限重试
+
+    Database& db;
+    std::chrono::milliseconds flush_interval;
+    size_t batch_rows;
+    size_t max_pending;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<Pending> pending;
+    std::vector<Pending> batch;     // 正在写入或等待重试的一批，只由写入线程修改
+    bool stopping;
+    SubmitQueueStats stats;
+    std::thread writer;
+
+    void run() {
+        int retry_ms = 0;
+        int attempts = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            if (retry_ms > 0) {
+                cond.wait_for(lock, std::chrono::milliseconds(retry_ms), [this]() { return stopping; });
+            }
+            else {
+                cond.wait(lock, [this]() { return stopping || !pending.empty(); });
+                if (!pending.empty()) {
+                    auto deadline = pending.front().queued_at + flush_interval;
+                    cond.wait_until(lock, deadline, [this]() { return stopping || pending.size() >= batch_rows; });
+                }
+            }
+            if (pending.empty() && batch.empty()) {
+                return;  // 只有stopping时才会走到这里
+            }
+
+            size_t take = std::min(pending.size(), batch_rows - std::min(batch.size(), batch_rows));
+            while (take > 0 && take < pending.size() && !pending[take - 1].group_end) {
+                ++take;
+            }
+            batch.insert(batch.end(), std::make_move_iterator(pending.begin()),
+                         std::make_move_iterator(pending.begin() + take));
+            pending.erase(pending.begin(), pending.begin() + take);
+            lock.unlock();
+
+            std::vector<GameResult> rows = coalesce(batch);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = db.submitGameResults(rows);
+            auto end = std::chrono::steady_clock::now();
+
+            lock.lock();
+            if (ok) {
+                recordBatch(rows.size(), start, end);
+                retry_ms = 0;
+                attempts = 0;
+                complete(lock, batch, true);
+                continue;
+            }
+
+            ++stats.failed_batches;
+            retry_ms = retry_ms == 0 ? kMinRetryMs : std::min(retry_ms * 2, kMaxRetryMs);
+            if (++attempts < kMaxAttempts) {
+                continue;
+            }
+            // 以失败答复这一批，客户端可以重新提交；停止时队列中剩余的成绩也不再尝试
+            size_t failed = batch.size() + (stopping ? pending.size() : 0);
+            stats.failed_results += failed;
+            LOG_ERROR("成绩写入连续失败 {} 次，{} 条成绩以失败答复", attempts, failed);
+            retry_ms = 0;
+            attempts = 0;
+            complete(lock, batch, false);
+            if (stopping) {
+                complete(lock, pending, false);
+                return;
+            }
+        }
+    }
+
+    // 取出items中各组的回调并清空items，解锁后调用，回调中可以再次submit
+    void complete(std::unique_lock<std::mutex>& lock, std::vector<Pending>& items, bool committed) {
+        std::vector<Completion> callbacks;
+        for (Pending& item : items) {
+            if (item.done) {
+                callbacks.push_back(std::move(item.done));
+            }
+        }
+        items.clear();
+        lock.unlock();
+        for (Completion& done : callbacks) {
+            done(committed);
+        }
+        lock.lock();
+    }
+
+    // 同一(类型, 用户, grid_size, used_undo)只保留一行，规则与数据库upsert一致:
+    // 关卡取最大值和最后提交时间；时间/步数取最小值和第一次达到该成绩的时间
+    static std::vector<GameResult> coalesce(const std::vector<Pending>& items) {
+        std::map<std::tuple<int, int, int, bool>, size_t> index;
+        std::vector<GameResult> rows;
+        rows.reserve(items.size());
+        for (const Pending& item : items) {
+            const GameResult& r = item.result;
+            auto key = std::make_tuple(static_cast<int>(r.type), r.user_id, r.grid_size, r.used_undo);
+            auto found = index.find(key);
+            if (found == index.end()) {
+                index.emplace(key, rows.size());
+                rows.push_back(r);
+                continue;
+            }
+            GameResult& merged = rows[found->second];
+            if (r.type == RankingType::Level) {
+                merged.score = std::max(merged.score, r.score);
+                merged.time = r.time;
+            }
+            else if (r.score < merged.score) {
+                merged.score = r.score;
+                merged.time = r.time;
+            }
+        }
+        return rows;
+    }
+
+    void recordBatch(size_t rows, std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end) {
+        uint64_t flush_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        uint64_t delay_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            end - batch.front().queued_at).count();
+        uint64_t size = batch.size();
+
+        ++stats.batches;
+        stats.written_rows += rows;
+        stats.total_flush_us += flush_us;
+        stats.max_flush_us = std::max(stats.max_flush_us, flush_us);
+        stats.max_delay_us = std::max(stats.max_delay_us, delay_us);
+        stats.max_batch = std::max(stats.max_batch, size);
+
+        size_t bucket = 0;
+        while (size > 1 && bucket + 1 < stats.batch_sizes.size()) {
+            size >>= 1;
+            ++bucket;
+        }
+        ++stats.batch_sizes[bucket];
+    }
+};
+
+#endif // SUBMIT_QUEUE_H
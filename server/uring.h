@@ -0,0 +1,299 @@
+#ifndef URING_H
+#define URING_H
+
+// 内核头文件中有io_uring定义时才编译io_uring后端，不依赖liburing，直接使用系统调用
+// 用到的COOP_TASKRUN、PBUF_RING(io_uring_buf/io_uring_buf_reg)和RECV_MULTISHOT要求6.0及以后的头文件，
+// 以其中最新的IORING_RECV_MULTISHOT判断；5.15等旧头文件只编译epoll后端
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT)
+#define PUZZLE_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef PUZZLE_HAVE_IO_URING
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// io_uring提交/完成队列的最小封装
+// - 只由一个线程使用(提交和收割都在所属reactor线程中)，不加锁
+// - SQ满时自动提交一次腾出空间
+// - 提供缓冲区环(provided buffer ring): 多次recv由内核从环中挑选缓冲区，处理完后放回
+// 需要Linux 6.0及以上(多次accept/recv、缓冲区环)，创建失败时构造函数抛出异常
+class IoUring {
+public:
+    explicit IoUring(unsigned entries)
+        : ring_fd(-1), ring_mem(MAP_FAILED), ring_size(0), sqes(nullptr), sqes_size(0),
+          sqe_tail(0), buf_ring(nullptr), buf_ring_size(0), buffers(nullptr), buffers_size(0),
+          buf_size(0), buf_mask(0), buf_tail(0), enter_calls(0) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        // 完成事件在下一次io_uring_enter时处理，不用中断打断正在运行的线程
+        params.flags = IORING_SETUP_COOP_TASKRUN;
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd < 0 && errno == EINVAL) {
+            memset(&params, 0, sizeof(params));
+            ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        }
+        if (ring_fd < 0) {
+            throw std::runtime_error(std::string("io_uring_setup失败: ") + strerror(errno));
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+            close(ring_fd);
+            throw std::runtime_error("内核不支持所需的io_uring特性");
+        }
+
+        ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                             params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ring_mem = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd, IORING_OFF_SQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_mem = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring_fd, IORING_OFF_SQES);
+        if (ring_mem == MAP_FAILED || sqe_mem == MAP_FAILED) {
+            if (sqe_mem != MAP_FAILED) munmap(sqe_mem, sqes_size);
+            release();
+            throw std::runtime_error("映射io_uring队列失败");
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_mem);
+
+        char* base = static_cast<char*>(ring_mem);
+        sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        // SQ数组与SQE一一对应，之后只需推进tail
+        unsigned* sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; ++i) {
+            sq_array[i] = i;
+        }
+        sqe_tail = *sq_tail;
+    }
+
+    ~IoUring() {
+        release();
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 注册count个(2的幂)大小为size的接收缓冲区，recv通过group使用
+    void setupBufferRing(uint16_t group, unsigned count, size_t size) {
+        buf_ring_size = count * sizeof(io_uring_buf);
+        void* ring = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        buffers_size = count * size;
+        void* data = mmap(nullptr, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED || data == MAP_FAILED) {
+            if (ring != MAP_FAILED) munmap(ring, buf_ring_size);
+            if (data != MAP_FAILED) munmap(data, buffers_size);
+            throw std::runtime_error("分配io_uring接收缓冲区失败");
+        }
+        buf_ring = static_cast<io_uring_buf*>(ring);
+        buffers = static_cast<char*>(data);
+        buf_size = size;
+        buf_mask = count - 1;
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            throw std::runtime_error(std::string("注册io_uring缓冲区环失败: ") + strerror(errno));
+        }
+        for (unsigned bid = 0; bid < count; ++bid) {
+            pushBuffer(static_cast<uint16_t>(bid));
+        }
+        publishBuffers();
+    }
+
+    const char* buffer(uint16_t bid) const { return buffers + static_cast<size_t>(bid) * buf_size; }
+
+    // 缓冲区中的数据处理完后放回环中
+    void recycleBuffer(uint16_t bid) {
+        pushBuffer(bid);
+        publishBuffers();
+    }
+
+    // ---- 请求，SQ已满且提交失败时返回false ----
+
+    // 多次accept: 一个请求持续接受新连接，每个连接一个完成事件
+    bool acceptMultishot(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_ACCEPT, fd, user_data);
+        if (!sqe) return false;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        // 新连接保持阻塞模式，socket不可读写时由io_uring挂起请求而不是返回-EAGAIN
+        sqe->accept_flags = SOCK_CLOEXEC;
+        return true;
+    }
+
+    // 多次recv: 数据到达时由内核从group中取缓冲区，每次接收一个完成事件
+    bool recvMultishot(int fd, uint16_t group, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_RECV, fd, user_data);
+        if (!sqe) return false;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = group;
+        return true;
+    }
+
+    // msg及其iovec在完成事件到达前必须保持有效
+    bool sendmsg(int fd, const msghdr* msg, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_SENDMSG, fd, user_data);
+        if (!sqe) return false;
+        sqe->addr = reinterpret_cast<uint64_t>(msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        return true;
+    }
+
+    // buf在完成事件到达前必须保持有效
+    bool read(int fd, void* buf, unsigned len, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_READ, fd, user_data);
+        if (!sqe) return false;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = len;
+        sqe->off = static_cast<uint64_t>(-1);
+        return true;
+    }
+
+    // 多次poll: fd每次变为可读产生一个完成事件
+    bool pollMultishot(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_POLL_ADD, fd, user_data);
+        if (!sqe) return false;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        return true;
+    }
+
+    // 取消user_data为target的请求，被取消的请求以-ECANCELED完成
+    bool cancel(uint64_t target, uint64_t user_data) {
+        io_uring_sqe* sqe = nextSqe(IORING_OP_ASYNC_CANCEL, -1, user_data);
+        if (!sqe) return false;
+        sqe->addr = target;
+        return true;
+    }
+
+    // 提交所有新请求，并等待至少wait_nr个完成事件；一次系统调用
+    int submitAndWait(unsigned wait_nr) {
+        __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+        unsigned to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (to_submit == 0 && wait_nr == 0) {
+            return 0;
+        }
+        ++enter_calls;
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr,
+                                           wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        return ret < 0 ? -errno : ret;
+    }
+
+    // 依次处理所有已完成的事件
+    template <typename Handler>
+    unsigned forEachCompletion(Handler&& handler) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & cq_mask];
+            ++head;
+            ++count;
+            // 先归还CQ槽位，回调中提交请求时不会因为CQ满而阻塞
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            handler(cqe);
+            if (head == tail) {
+                tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            }
+        }
+        return count;
+    }
+
+    uint64_t enterCalls() const { return enter_calls; }
+
+private:
+    int ring_fd;
+    void* ring_mem;
+    size_t ring_size;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;          // 本地tail，submitAndWait时发布给内核
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+    io_uring_buf* buf_ring;
+    size_t buf_ring_size;
+    char* buffers;
+    size_t buffers_size;
+    size_t buf_size;
+    unsigned buf_mask;
+    uint16_t buf_tail;
+    uint64_t enter_calls;       // io_uring_enter调用次数
+
+    io_uring_sqe* nextSqe(uint8_t opcode, int fd, uint64_t user_data) {
+        if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            submitAndWait(0);
+            if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+                return nullptr;
+            }
+        }
+        io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+        ++sqe_tail;
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->user_data = user_data;
+        return sqe;
+    }
+
+    void pushBuffer(uint16_t bid) {
+        io_uring_buf& buf = buf_ring[buf_tail & buf_mask];
+        buf.addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(bid) * buf_size);
+        buf.len = static_cast<uint32_t>(buf_size);
+        buf.bid = bid;
+        ++buf_tail;
+    }
+
+    // 环的tail与第一个缓冲区描述的resv字段重叠
+    void publishBuffers() {
+        __atomic_store_n(&buf_ring[0].resv, buf_tail, __ATOMIC_RELEASE);
+    }
+
+    void release() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (ring_mem != MAP_FAILED) munmap(ring_mem, ring_size);
+        if (ring_fd != -1) close(ring_fd);
+        if (buf_ring) munmap(buf_ring, buf_ring_size);
+        if (buffers) munmap(buffers, buffers_size);
+        sqes = nullptr;
+        ring_mem = MAP_FAILED;
+        ring_fd = -1;
+        buf_ring = nullptr;
+        buffers = nullptr;
+    }
+};
+
+#endif // PUZZLE_HAVE_IO_URING
+
+#endif // URING_H
@@ -0,0 +1,162 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+// 用户缓存统计信息，不使用缓存的存储后端全部为0
+struct UserCacheStats {
+    uint64_t hits = 0;              // 登录命中缓存的次数
+    uint64_t misses = 0;            // 需要查询数据库的次数
+    uint64_t evictions = 0;         // 超过容量被淘汰的记录数
+    uint64_t invalidations = 0;     // 被显式失效的记录数
+    uint64_t expirations = 0;       // 超过有效期被丢弃的记录数
+    size_t size = 0;                // 当前缓存的记录数
+    size_t pending_logins = 0;      // 等待写入的最后登录时间
+    uint64_t flushed_logins = 0;    // 已写入数据库的最后登录时间
+    uint64_t failed_flushes = 0;    // 写入失败(之后重试)的次数
+};
+
+// 登录凭据的LRU缓存(用户名 -> 用户id、密码、昵称)
+// - 只缓存数据库确认过的用户名和密码组合；密码与缓存不一致时仍交给数据库判断，
+//   数据库的比较规则(排序规则、改过的密码)始终有效
+// - 记录在数据库确认后ttl内有效，过期后下一次登录重新查询数据库；
+//   在服务器之外修改密码或删除用户后，旧凭据最多还能登录ttl这么久
+// - 所有方法加同一把锁，临界区内只有哈希查找和链表移动
+class UserCache {
+public:
+    UserCache(size_t capacity, std::chrono::seconds ttl) : capacity(capacity), ttl(ttl) {}
+
+    bool enabled() const { return capacity > 0; }
+
+    // 用户名和密码都与未过期的缓存一致时返回true，并输出用户id和昵称
+    bool verify(const std::string& username, const std::string& password, int& user_id, std::string& nickname) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(username);
+        if (it != index.end() && ttl.count() > 0 && Clock::now() - it->second->verified_at >= ttl) {
+            lru.erase(it->second);
+            index.erase(it);
+            ++stats.expirations;
+            ++stats.misses;
+            return false;
+        }
+        if (it == index.end() || it->second->password != password) {
+            ++stats.misses;
+            return false;
+        }
+        lru.splice(lru.begin(), lru, it->second);
+        user_id = it->second->user_id;
+        nickname = it->second->nickname;
+        ++stats.hits;
+        return true;
+    }
+
+    // 数据库确认登录成功后放入缓存，已存在时更新、重新计算有效期并移到最前
+    void insert(const std::string& username, const std::string& password, int user_id, const std::string& nickname) {
+        if (!enabled()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(username);
+        if (it != index.end()) {
+            it->second->password = password;
+            it->second->user_id = user_id;
+            it->second->nickname = nickname;
+            it->second->verified_at = Clock::now();
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+        lru.push_front(Entry{username, password, user_id, nickname, Clock::now()});
+        index[username] = lru.begin();
+        if (lru.size() > capacity) {
+            index.erase(lru.back().username);
+            lru.pop_back();
+            ++stats.evictions;
+        }
+    }
+
+    void invalidate(const std::string& username) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(username);
+        if (it != index.end()) {
+            lru.erase(it->second);
+            index.erase(it);
+            ++stats.invalidations;
+        }
+    }
+
+    UserCacheStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        UserCacheStats result = stats;
+        result.size = lru.size();
+        return result;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string username;
+        std::string password;
+        int user_id;
+        std::string nickname;
+        Clock::time_point verified_at;  // 最近一次由数据库确认的时间
+    };
+
+    size_t capacity;
+    std::chrono::seconds ttl;   // 0表示不过期
+    std::mutex mutex;
+    std::list<Entry> lru;   // 最近使用的在前
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    UserCacheStats stats;
+};
+
+// 延迟写入的最后登录时间，每个用户只保留最近一次
+// 登录时只记入内存，由定时任务取出后批量写入数据库
+class LastLoginBuffer {
+public:
+    void record(int user_id, std::time_t time) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::time_t& latest = pending[user_id];
+        latest = std::max(latest, time);
+    }
+
+    // 取出全部待写入的记录
+    std::vector<std::pair<int, std::time_t>> take() {
+        std::unordered_map<int, std::time_t> taken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            taken.swap(pending);
+        }
+        return std::vector<std::pair<int, std::time_t>>(taken.begin(), taken.end());
+    }
+
+    // 写入失败的记录放回，期间又登录过的用户保留较新的时间
+    void restore(std::vector<std::pair<int, std::time_t>>::const_iterator begin,
+                 std::vector<std::pair<int, std::time_t>>::const_iterator end) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = begin; it != end; ++it) {
+            std::time_t& latest = pending[it->first];
+            latest = std::max(latest, it->second);
+        }
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size();
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<int, std::time_t> pending;
+};
+
+#endif // USER_CACHE_H
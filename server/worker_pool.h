@@ -0,0 +1,97 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定大小的工作线程池
+// 任务队列有上限，队列满时submit()返回false，由调用方决定如何拒绝请求，
+// 避免请求在内存里无限堆积。
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool(size_t thread_count, size_t max_queue_depth)
+        : max_queue_depth(max_queue_depth), stopping(false) {
+        if (thread_count == 0) {
+            thread_count = 1;
+        }
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~WorkerPool() {
+        shutdown();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    bool submit(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || tasks.size() >= max_queue_depth) {
+                return false;
+            }
+            tasks.push_back(std::move(task));
+        }
+        cond.notify_one();
+        return true;
+    }
+
+    // 等待已入队的任务执行完后退出所有线程
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto& thread : threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    size_t queueSize() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return tasks.size();
+    }
+
+    size_t threadCount() const { return threads.size(); }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t max_queue_depth;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+#endif // WORKER_POOL_H
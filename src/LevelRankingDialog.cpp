@@ -3,11 +3,15 @@
 #include <QTableWidgetItem>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QScrollBar>
+
+static const int kPageSize = 50;
 
 LevelRankingDialog::LevelRankingDialog(NetworkClient *networkClient, QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::LevelRankingDialog)
     , network_client(networkClient)
+    , loading_more(false)
 {
     ui->setupUi(this);
     
@@ -17,6 +21,7 @@ LevelRankingDialog::LevelRankingDialog(NetworkClient *networkClient, QWidget *pa
     
     // 连接信号
     connect(network_client, &NetworkClient::levelRankingsFinished, this, &LevelRankingDialog::onLevelRankingsFinished);
+    connect(ui->tableWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, &LevelRankingDialog::onTableScrolled);
     
     // 初始化表格
     clearTable();
@@ -40,9 +45,23 @@ void LevelRankingDialog::on_btnBack_clicked()
 
 void LevelRankingDialog::onLevelRankingsFinished(const NetworkResponse &response, const QList<LevelRankingInfo> &rankings)
 {
+    bool appending = loading_more;
+    loading_more = false;
+    
     if (response.success) {
-        updateTable(rankings);
-        showStatus(QString("加载成功，共 %1 条记录").arg(rankings.size()));
+        next_cursor = response.next_cursor;
+        if (appending) {
+            appendRows(rankings);
+        } else {
+            updateTable(rankings);
+        }
+        
+        int loaded = ui->tableWidget->rowCount();
+        if (next_cursor.isEmpty()) {
+            showStatus(QString("加载成功，共 %1 条记录").arg(loaded));
+        } else {
+            showStatus(QString("已加载 %1 条记录，向下滚动加载更多").arg(loaded));
+        }
     } else {
         showStatus(response.message, true);
     }
@@ -55,31 +74,60 @@ void LevelRankingDialog::loadRankings()
         return;
     }
     
+    next_cursor.clear();
+    loading_more = false;
+    
     ui->btnRefresh->setEnabled(false);
     showStatus("正在加载排行榜数据...");
     
-    network_client->getLevelRankings(50); // 获取前50名
+    network_client->getLevelRankings(kPageSize); // 第一页
+}
+
+void LevelRankingDialog::onTableScrolled(int value)
+{
+    // 滚动到接近底部时加载下一页
+    if (value >= ui->tableWidget->verticalScrollBar()->maximum() - 2) {
+        loadMoreRankings();
+    }
+}
+
+void LevelRankingDialog::loadMoreRankings()
+{
+    if (loading_more || next_cursor.isEmpty() || !network_client->isConnected()) {
+        return;
+    }
+    
+    loading_more = true;
+    showStatus("正在加载更多...");
+    ui->btnRefresh->setEnabled(false);
+    
+    network_client->getLevelRankings(kPageSize, next_cursor);
 }
 
 void LevelRankingDialog::updateTable(const QList<LevelRankingInfo> &rankings)
 {
     clearTable();
-    
+    appendRows(rankings);
+}
+
+void LevelRankingDialog::appendRows(const QList<LevelRankingInfo> &rankings)
+{
     for (int i = 0; i < rankings.size(); ++i) {
         const LevelRankingInfo &info = rankings[i];
+        int rank = ui->tableWidget->rowCount() + 1;
         
         // 排名
-        QTableWidgetItem *rankItem = new QTableWidgetItem(QString::number(i + 1));
+        QTableWidgetItem *rankItem = new QTableWidgetItem(QString::number(rank));
         rankItem->setTextAlignment(Qt::AlignCenter);
         
         // 设置排名样式
-        if (i == 0) {
+        if (rank == 1) {
             rankItem->setForeground(QColor(255, 215, 0)); // 金色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
-        } else if (i == 1) {
+        } else if (rank == 2) {
             rankItem->setForeground(QColor(192, 192, 192)); // 银色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
-        } else if (i == 2) {
+        } else if (rank == 3) {
             rankItem->setForeground(QColor(205, 127, 50)); // 铜色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
         }
@@ -20,13 +20,18 @@ private slots:
     void on_btnRefresh_clicked();
     void on_btnBack_clicked();
     void onLevelRankingsFinished(const NetworkResponse &response, const QList<LevelRankingInfo> &rankings);
+    void onTableScrolled(int value);
 
 private:
     Ui::LevelRankingDialog *ui;
     NetworkClient *network_client;
+    QString next_cursor;    // 下一页游标，为空表示已全部加载
+    bool loading_more;
 
     void loadRankings();
+    void loadMoreRankings();
     void updateTable(const QList<LevelRankingInfo> &rankings);
+    void appendRows(const QList<LevelRankingInfo> &rankings);
     void clearTable();
     void showStatus(const QString &message, bool isError = false);
 };
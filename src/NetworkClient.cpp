@@ -7,6 +7,7 @@ NetworkClient::NetworkClient(QObject *parent)
     : QObject(parent)
     , socket(new QTcpSocket(this))
     , reconnect_timer(new QTimer(this))
+    , submit_timer(new QTimer(this))
     , server_port(8080)
 {
     // 连接socket信号
@@ -22,6 +23,11 @@ NetworkClient::NetworkClient(QObject *parent)
             connectToServer(server_host, server_port);
         }
     });
+
+    // 成绩合并发送定时器
+    submit_timer->setSingleShot(true);
+    submit_timer->setInterval(kSubmitBatchWindowMs);
+    connect(submit_timer, &QTimer::timeout, this, &NetworkClient::flushPendingResults);
 }
 
 NetworkClient::~NetworkClient()
@@ -88,11 +94,23 @@ void NetworkClient::loginUser(const QString &username, const QString &password)
 
 void NetworkClient::logout()
 {
+    // 会话失效前把还没发出的成绩发送出去；断线时发不出去的成绩不能留给下一个登录的用户
+    submit_timer->stop();
+    flushPendingResults();
+    failPendingResults(pending_results, "已退出登录，成绩未提交");
+    pending_results = QJsonArray();
+
+    // 令牌加入服务器的吊销表，之后不能再使用
+    if (isConnected() && isLoggedIn()) {
+        QJsonObject data;
+        data["session_id"] = current_user.session_id;
+        sendJson(createRequest("logout", data));
+    }
     current_user = UserInfo();
     emit logoutFinished();
 }
 
-void NetworkClient::getLevelRankings(int limit)
+void NetworkClient::getLevelRankings(int limit, const QString &cursor)
 {
     if (!isConnected()) {
         emit levelRankingsFinished(NetworkResponse(false, "未连接到服务器"), QList<LevelRankingInfo>());
@@ -101,12 +119,15 @@ void NetworkClient::getLevelRankings(int limit)
 
     QJsonObject data;
     data["limit"] = limit;
+    if (!cursor.isEmpty()) {
+        data["cursor"] = cursor;
+    }
 
     QJsonObject request = createRequest("get_level_rankings", data);
     sendJson(request);
 }
 
-void NetworkClient::getTimeRankings(int grid_size, bool used_undo, int limit)
+void NetworkClient::getTimeRankings(int grid_size, bool used_undo, int limit, const QString &cursor)
 {
     if (!isConnected()) {
         emit timeRankingsFinished(NetworkResponse(false, "未连接到服务器"), QList<TimeRankingInfo>());
@@ -117,12 +138,15 @@ void NetworkClient::getTimeRankings(int grid_size, bool used_undo, int limit)
     data["grid_size"] = grid_size;
     data["used_undo"] = used_undo;
     data["limit"] = limit;
+    if (!cursor.isEmpty()) {
+        data["cursor"] = cursor;
+    }
 
     QJsonObject request = createRequest("get_time_rankings", data);
     sendJson(request);
 }
 
-void NetworkClient::getStepRankings(int grid_size, bool used_undo, int limit)
+void NetworkClient::getStepRankings(int grid_size, bool used_undo, int limit, const QString &cursor)
 {
     if (!isConnected()) {
         emit stepRankingsFinished(NetworkResponse(false, "未连接到服务器"), QList<StepRankingInfo>());
@@ -133,39 +157,157 @@ void NetworkClient::getStepRankings(int grid_size, bool used_undo, int limit)
     data["grid_size"] = grid_size;
     data["used_undo"] = used_undo;
     data["limit"] = limit;
+    if (!cursor.isEmpty()) {
+        data["cursor"] = cursor;
+    }
 
     QJsonObject request = createRequest("get_step_rankings", data);
     sendJson(request);
 }
 
+void NetworkClient::getMyRank(const QString &game_type, int grid_size, bool used_undo)
+{
+    if (!isConnected() || !isLoggedIn()) {
+        emit myRankFinished(NetworkResponse(false, "未连接到服务器或未登录"), RankingWindowInfo());
+        return;
+    }
+
+    QJsonObject data = createRankQuery(game_type, grid_size, used_undo);
+
+    QJsonObject request = createRequest("get_my_rank", data);
+    sendJson(request);
+}
+
+void NetworkClient::getRankingsAround(const QString &game_type, int grid_size, bool used_undo, int range)
+{
+    if (!isConnected() || !isLoggedIn()) {
+        emit rankingsAroundFinished(NetworkResponse(false, "未连接到服务器或未登录"), RankingWindowInfo());
+        return;
+    }
+
+    QJsonObject data = createRankQuery(game_type, grid_size, used_undo);
+    data["range"] = range;
+
+    QJsonObject request = createRequest("get_rankings_around", data);
+    sendJson(request);
+}
+
 void NetworkClient::submitGameResult(const QString &game_type, int grid_size, 
                                      int max_level, int time_seconds, 
                                      int step_count, bool used_undo)
 {
-    if (!isConnected() || !isLoggedIn()) {
-        emit submitGameResultFinished(NetworkResponse(false, "未连接到服务器或未登录"));
+    if (!isLoggedIn()) {
+        emit submitGameResultFinished(NetworkResponse(false, "未登录"));
         return;
     }
 
-    QJsonObject data;
-    data["user_id"] = current_user.user_id;
-    data["session_id"] = current_user.session_id;
-    data["game_type"] = game_type;
+    QJsonObject result;
+    result["game_type"] = game_type;
     
     if (game_type == "level") {
-        data["max_level"] = max_level;
+        result["max_level"] = max_level;
     } else if (game_type == "time") {
-        data["grid_size"] = grid_size;
-        data["time_seconds"] = time_seconds;
-        data["used_undo"] = used_undo;
+        result["grid_size"] = grid_size;
+        result["time_seconds"] = time_seconds;
+        result["used_undo"] = used_undo;
     } else if (game_type == "step") {
-        data["grid_size"] = grid_size;
-        data["step_count"] = step_count;
-        data["used_undo"] = used_undo;
+        result["grid_size"] = grid_size;
+        result["step_count"] = step_count;
+        result["used_undo"] = used_undo;
     }
 
-    QJsonObject request = createRequest("submit_game_result", data);
-    sendJson(request);
+    pending_results.append(result);
+    trimPendingResults();
+
+    if (isConnected() && !submit_timer->isActive()) {
+        submit_timer->start(kSubmitBatchWindowMs);
+    }
+}
+
+void NetworkClient::flushPendingResults()
+{
+    // 断线时保留，重连后再发送
+    if (!isConnected() || !isLoggedIn()) {
+        return;
+    }
+
+    while (!pending_results.isEmpty()) {
+        QJsonArray batch;
+        while (!pending_results.isEmpty() && batch.size() < kMaxSubmitBatch) {
+            batch.append(pending_results.first());
+            pending_results.removeFirst();
+        }
+
+        QJsonObject data;
+        data["session_id"] = current_user.session_id;
+        data["results"] = batch;
+
+        QJsonObject request = createRequest("submit_game_results", data);
+        if (!sendJson(request)) {
+            // 写入失败，放回队首等重连后发送
+            for (int i = batch.size() - 1; i >= 0; --i) {
+                pending_results.prepend(batch[i]);
+            }
+            return;
+        }
+        inflight_batches.append(SubmitBatch{current_user.user_id, batch});
+    }
+}
+
+// 一批成绩收到响应(或请求被拒绝): 服务器繁忙或写库失败时放回队首稍后重发，
+// 成绩按最好成绩合并，重复提交没有副作用；其他结果逐条通知
+void NetworkClient::finishSubmitBatch(const NetworkResponse &response)
+{
+    if (inflight_batches.isEmpty()) {
+        return;
+    }
+    SubmitBatch batch = inflight_batches.takeFirst();
+
+    bool retry = !response.success
+        && (response.error_code == "SERVER_BUSY" || response.error_code == "DATABASE_ERROR");
+    if (retry && isLoggedIn() && current_user.user_id == batch.user_id) {
+        for (int i = batch.results.size() - 1; i >= 0; --i) {
+            pending_results.prepend(batch.results[i]);
+        }
+        trimPendingResults();
+        submit_timer->start(kSubmitRetryMs);
+        return;
+    }
+    for (int i = 0; i < batch.results.size(); ++i) {
+        emit submitGameResultFinished(response);
+    }
+}
+
+// 断线时没有收到响应的成绩放回队首，重连后重新发送；已经换了用户时通知失败
+void NetworkClient::requeueInflightBatches()
+{
+    while (!inflight_batches.isEmpty()) {
+        SubmitBatch batch = inflight_batches.takeLast();
+        if (!isLoggedIn() || current_user.user_id != batch.user_id) {
+            failPendingResults(batch.results, "连接已断开，成绩未提交");
+            continue;
+        }
+        for (int i = batch.results.size() - 1; i >= 0; --i) {
+            pending_results.prepend(batch.results[i]);
+        }
+    }
+    trimPendingResults();
+}
+
+void NetworkClient::failPendingResults(const QJsonArray &results, const QString &message)
+{
+    for (int i = 0; i < results.size(); ++i) {
+        emit submitGameResultFinished(NetworkResponse(false, message));
+    }
+}
+
+// 断线太久积攒的成绩超过上限时丢弃最早的
+void NetworkClient::trimPendingResults()
+{
+    while (pending_results.size() > kMaxPendingResults) {
+        pending_results.removeFirst();
+        emit submitGameResultFinished(NetworkResponse(false, "待提交的成绩过多，最早的成绩已丢弃"));
+    }
 }
 
 UserInfo NetworkClient::getCurrentUser() const
@@ -183,6 +325,9 @@ void NetworkClient::onConnected()
     qDebug() << "Connected to server";
     buffer.clear();
     reconnect_timer->stop();
+    if (!pending_results.isEmpty()) {
+        submit_timer->start(kSubmitBatchWindowMs);
+    }
     emit connected();
 }
 
@@ -190,6 +335,8 @@ void NetworkClient::onDisconnected()
 {
     qDebug() << "Disconnected from server";
     buffer.clear();
+    outstanding_requests.clear();
+    requeueInflightBatches();
     emit disconnected();
     
     // 启动重连定时器
@@ -253,7 +400,11 @@ bool NetworkClient::sendJson(const QJsonObject &json)
     packet.append(data);
 
     qint64 bytesWritten = socket->write(packet);
-    return bytesWritten == packet.size();
+    if (bytesWritten != packet.size()) {
+        return false;
+    }
+    outstanding_requests.enqueue(json["type"].toString());
+    return true;
 }
 
 void NetworkClient::processResponse(const QByteArray &data)
@@ -283,6 +434,15 @@ void NetworkClient::handleResponse(const QJsonObject &response)
     QString error_code = response["error_code"].toString();
 
     NetworkResponse network_response(success, message, dataValue.toObject(), error_code);
+    network_response.next_cursor = response["next_cursor"].toString();
+
+    // 服务器按请求顺序响应，队首就是这条响应对应的请求(type为error的响应只能据此判断)
+    QString request_type = outstanding_requests.isEmpty() ? QString() : outstanding_requests.dequeue();
+
+    // 服务器换发的会话令牌
+    if (response["session_id"].isString() && isLoggedIn()) {
+        current_user.session_id = response["session_id"].toString();
+    }
 
     if (type == "register_response") {
         emit registerFinished(network_response);
@@ -324,11 +484,36 @@ void NetworkClient::handleResponse(const QJsonObject &response)
         }
         emit stepRankingsFinished(network_response, rankings);
     }
-    else if (type == "submit_result_response") {
-        emit submitGameResultFinished(network_response);
+    else if (type == "my_rank_response") {
+        RankingWindowInfo info;
+        if (success && dataValue.isObject()) {
+            info = parseRankingWindow(dataValue.toObject());
+        }
+        emit myRankFinished(network_response, info);
+    }
+    else if (type == "rankings_around_response") {
+        RankingWindowInfo info;
+        if (success && dataValue.isObject()) {
+            info = parseRankingWindow(dataValue.toObject());
+        }
+        emit rankingsAroundFinished(network_response, info);
+    }
+    else if (type == "submit_result_response" || type == "submit_results_response") {
+        if (request_type == "submit_game_results") {
+            finishSubmitBatch(network_response);
+        }
+        else {
+            emit submitGameResultFinished(network_response);
+        }
+    }
+    else if (type == "logout_response") {
+        // 本地状态在logout()中已经清除
     }
     else if (type == "error") {
         qWarning() << "Server error:" << message << "(" << error_code << ")";
+        if (request_type == "submit_game_results") {
+            finishSubmitBatch(network_response);
+        }
     }
     else {
         qWarning() << "Unknown response type:" << type;
@@ -397,6 +582,36 @@ QList<StepRankingInfo> NetworkClient::parseStepRankings(const QJsonArray &array)
     return rankings;
 }
 
+RankingWindowInfo NetworkClient::parseRankingWindow(const QJsonObject &data)
+{
+    RankingWindowInfo info;
+    info.game_type = data["game_type"].toString();
+    info.grid_size = data["grid_size"].toInt();
+    info.used_undo = data["used_undo"].toBool();
+    info.rank = data["rank"].toInt();
+    info.total = data["total"].toInt();
+
+    // get_my_rank只返回自己的一行
+    QJsonArray rows;
+    if (data.contains("rankings")) {
+        rows = data["rankings"].toArray();
+        info.first_rank = data["first_rank"].toInt();
+    } else if (data["entry"].isObject()) {
+        rows.append(data["entry"]);
+        info.first_rank = info.rank;
+    }
+
+    if (info.game_type == "level") {
+        info.level_rankings = parseLevelRankings(rows);
+    } else if (info.game_type == "time") {
+        info.time_rankings = parseTimeRankings(rows);
+    } else if (info.game_type == "step") {
+        info.step_rankings = parseStepRankings(rows);
+    }
+
+    return info;
+}
+
 QString NetworkClient::formatTime(int seconds) const
 {
     int hours = seconds / 3600;
@@ -415,6 +630,18 @@ QString NetworkClient::formatTime(int seconds) const
     }
 }
 
+QJsonObject NetworkClient::createRankQuery(const QString &game_type, int grid_size, bool used_undo)
+{
+    QJsonObject data;
+    data["session_id"] = current_user.session_id;
+    data["game_type"] = game_type;
+    if (game_type != "level") {
+        data["grid_size"] = grid_size;
+        data["used_undo"] = used_undo;
+    }
+    return data;
+}
+
 QJsonObject NetworkClient::createRequest(const QString &type, const QJsonObject &data)
 {
     QJsonObject request;
@@ -9,6 +9,7 @@
 #include <QJsonValue>
 #include <QJsonArray>
 #include <QTimer>
+#include <QQueue>
 #include <QNetworkReply>
 
 // 网络响应数据结构
@@ -17,6 +18,7 @@ struct NetworkResponse {
     QString message;
     QJsonObject data;
     QString error_code;
+    QString next_cursor;  // 排行榜下一页游标，为空表示没有更多数据
     
     NetworkResponse() : success(false) {}
     NetworkResponse(bool s, const QString& msg, const QJsonObject& d = QJsonObject(), const QString& err = QString())
@@ -77,6 +79,22 @@ struct StepRankingInfo {
     StepRankingInfo() : id(0), user_id(0), grid_size(0), step_count(0), used_undo(false) {}
 };
 
+// 我的排名及附近名次
+struct RankingWindowInfo {
+    QString game_type;
+    int grid_size;
+    bool used_undo;
+    int rank;        // 从1开始，不在榜上为0
+    int total;       // 该排行榜总人数
+    int first_rank;  // 列表中第一行的名次
+    // 按game_type只有一个列表有数据；get_my_rank时只包含自己的一行
+    QList<LevelRankingInfo> level_rankings;
+    QList<TimeRankingInfo> time_rankings;
+    QList<StepRankingInfo> step_rankings;
+    
+    RankingWindowInfo() : grid_size(0), used_undo(false), rank(0), total(0), first_rank(0) {}
+};
+
 class NetworkClient : public QObject
 {
     Q_OBJECT
@@ -96,11 +114,17 @@ public:
     void logout();
 
     // 排行榜相关
-    void getLevelRankings(int limit = 50);
-    void getTimeRankings(int grid_size, bool used_undo, int limit = 50);
-    void getStepRankings(int grid_size, bool used_undo, int limit = 50);
+    // cursor为上一页响应中的next_cursor，为空时从第一名开始
+    void getLevelRankings(int limit = 50, const QString &cursor = QString());
+    void getTimeRankings(int grid_size, bool used_undo, int limit = 50, const QString &cursor = QString());
+    void getStepRankings(int grid_size, bool used_undo, int limit = 50, const QString &cursor = QString());
+    void getMyRank(const QString &game_type, int grid_size = 0, bool used_undo = false);
+    void getRankingsAround(const QString &game_type, int grid_size = 0, bool used_undo = false, int range = 5);
 
     // 游戏数据提交
+    // 成绩先放入待提交队列，kSubmitBatchWindowMs内的多条成绩合并为一条submit_game_results发送；
+    // 已登录但断线时保留到重连后再发送。发出后直到收到响应才移出队列，断线、服务器繁忙或写库失败时
+    // 放回队列重发。每次调用最终对应一次submitGameResultFinished
     void submitGameResult(const QString &game_type, int grid_size = 0, 
                          int max_level = 0, int time_seconds = 0, 
                          int step_count = 0, bool used_undo = false);
@@ -124,8 +148,10 @@ signals:
     void levelRankingsFinished(const NetworkResponse &response, const QList<LevelRankingInfo> &rankings);
     void timeRankingsFinished(const NetworkResponse &response, const QList<TimeRankingInfo> &rankings);
     void stepRankingsFinished(const NetworkResponse &response, const QList<StepRankingInfo> &rankings);
+    void myRankFinished(const NetworkResponse &response, const RankingWindowInfo &info);
+    void rankingsAroundFinished(const NetworkResponse &response, const RankingWindowInfo &info);
 
-    // 游戏数据提交信号
+    // 游戏数据提交信号，每条成绩一次；合并发送的成绩各自收到所在批次的响应
     void submitGameResultFinished(const NetworkResponse &response);
 
 private slots:
@@ -139,11 +165,30 @@ private:
     UserInfo current_user;
     QByteArray buffer;
     QTimer *reconnect_timer;
+    QTimer *submit_timer;
+    QJsonArray pending_results;  // 等待批量发送的成绩
+    // 已发送、等待submit_results_response的一批成绩
+    struct SubmitBatch {
+        int user_id;
+        QJsonArray results;
+    };
+    QList<SubmitBatch> inflight_batches;  // 按发送顺序
+    QQueue<QString> outstanding_requests;  // 已发送请求的类型，服务器按请求顺序响应
     QString server_host;
     int server_port;
 
+    static const int kSubmitBatchWindowMs = 50;  // 成绩合并发送的等待时间
+    static const int kMaxSubmitBatch = 64;       // 单条submit_game_results最多携带的成绩数
+    static const int kMaxPendingResults = 256;   // 断线期间最多保留的成绩数
+    static const int kSubmitRetryMs = 1000;      // 服务器繁忙或写库失败后重发的等待时间
+
     // 发送和接收数据
     bool sendJson(const QJsonObject &json);
+    void flushPendingResults();
+    void finishSubmitBatch(const NetworkResponse &response);
+    void requeueInflightBatches();
+    void failPendingResults(const QJsonArray &results, const QString &message);
+    void trimPendingResults();
     void processResponse(const QByteArray &data);
     void handleResponse(const QJsonObject &response);
 
@@ -151,6 +196,8 @@ private:
     QList<LevelRankingInfo> parseLevelRankings(const QJsonArray &array);
     QList<TimeRankingInfo> parseTimeRankings(const QJsonArray &array);
     QList<StepRankingInfo> parseStepRankings(const QJsonArray &array);
+    RankingWindowInfo parseRankingWindow(const QJsonObject &data);
+    QJsonObject createRankQuery(const QString &game_type, int grid_size, bool used_undo);
 
     // 工具函数
     QString formatTime(int seconds) const;
@@ -20,13 +20,20 @@ private slots:
     void on_btnRefresh_clicked();
     void on_btnBack_clicked();
     void onStepRankingsFinished(const NetworkResponse &response, const QList<StepRankingInfo> &rankings);
+    void onTableScrolled(int value);
 
 private:
     Ui::StepRankingDialog *ui;
     NetworkClient *network_client;
+    QString next_cursor;    // 下一页游标，为空表示已全部加载
+    bool loading_more;
+    int query_grid_size;    // 当前查询条件，翻页时沿用
+    bool query_used_undo;
 
     void loadRankings();
+    void loadMoreRankings();
     void updateTable(const QList<StepRankingInfo> &rankings);
+    void appendRows(const QList<StepRankingInfo> &rankings);
     void clearTable();
     void showStatus(const QString &message, bool isError = false);
 };
@@ -3,11 +3,17 @@
 #include <QTableWidgetItem>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QScrollBar>
+
+static const int kPageSize = 50;
 
 TimeRankingDialog::TimeRankingDialog(NetworkClient *networkClient, QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::TimeRankingDialog)
     , network_client(networkClient)
+    , loading_more(false)
+    , query_grid_size(0)
+    , query_used_undo(false)
 {
     ui->setupUi(this);
     
@@ -17,6 +23,7 @@ TimeRankingDialog::TimeRankingDialog(NetworkClient *networkClient, QWidget *pare
     
     // 连接信号
     connect(network_client, &NetworkClient::timeRankingsFinished, this, &TimeRankingDialog::onTimeRankingsFinished);
+    connect(ui->tableWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, &TimeRankingDialog::onTableScrolled);
     
     // 初始化表格
     clearTable();
@@ -41,9 +48,23 @@ void TimeRankingDialog::on_btnBack_clicked()
 void TimeRankingDialog::onTimeRankingsFinished(const NetworkResponse &response, const QList<TimeRankingInfo> &rankings)
 {
     qDebug() << "TimeRankingDialog: onTimeRankingsFinished called, success:" << response.success << "rankings.size():" << rankings.size();
+    bool appending = loading_more;
+    loading_more = false;
+    
     if (response.success) {
-        updateTable(rankings);
-        showStatus(QString("查询成功，共 %1 条记录").arg(rankings.size()));
+        next_cursor = response.next_cursor;
+        if (appending) {
+            appendRows(rankings);
+        } else {
+            updateTable(rankings);
+        }
+        
+        int loaded = ui->tableWidget->rowCount();
+        if (next_cursor.isEmpty()) {
+            showStatus(QString("查询成功，共 %1 条记录").arg(loaded));
+        } else {
+            showStatus(QString("已查询 %1 条记录，向下滚动查询更多").arg(loaded));
+        }
     } else {
         showStatus(response.message, true);
     }
@@ -73,32 +94,63 @@ void TimeRankingDialog::loadRankings()
         usedUndo = false;
     }
     
+    query_grid_size = gridSize;
+    query_used_undo = usedUndo;
+    next_cursor.clear();
+    loading_more = false;
+    
     ui->btnRefresh->setEnabled(false);
     showStatus("正在查询排行榜数据...");
     
-    network_client->getTimeRankings(gridSize, usedUndo, 50);
+    network_client->getTimeRankings(gridSize, usedUndo, kPageSize);
+}
+
+void TimeRankingDialog::onTableScrolled(int value)
+{
+    // 滚动到接近底部时加载下一页
+    if (value >= ui->tableWidget->verticalScrollBar()->maximum() - 2) {
+        loadMoreRankings();
+    }
+}
+
+void TimeRankingDialog::loadMoreRankings()
+{
+    if (loading_more || next_cursor.isEmpty() || !network_client->isConnected()) {
+        return;
+    }
+    
+    loading_more = true;
+    showStatus("正在查询更多...");
+    ui->btnRefresh->setEnabled(false);
+    
+    network_client->getTimeRankings(query_grid_size, query_used_undo, kPageSize, next_cursor);
 }
 
 void TimeRankingDialog::updateTable(const QList<TimeRankingInfo> &rankings)
 {
     qDebug() << "TimeRankingDialog: updateTable called with" << rankings.size() << "rankings";
     clearTable();
-    
+    appendRows(rankings);
+}
+
+void TimeRankingDialog::appendRows(const QList<TimeRankingInfo> &rankings)
+{
     for (int i = 0; i < rankings.size(); ++i) {
         const TimeRankingInfo &info = rankings[i];
+        int rank = ui->tableWidget->rowCount() + 1;
         
         // 排名
-        QTableWidgetItem *rankItem = new QTableWidgetItem(QString::number(i + 1));
+        QTableWidgetItem *rankItem = new QTableWidgetItem(QString::number(rank));
         rankItem->setTextAlignment(Qt::AlignCenter);
         
         // 设置排名样式
-        if (i == 0) {
+        if (rank == 1) {
             rankItem->setForeground(QColor(255, 215, 0)); // 金色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
-        } else if (i == 1) {
+        } else if (rank == 2) {
             rankItem->setForeground(QColor(192, 192, 192)); // 银色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
-        } else if (i == 2) {
+        } else if (rank == 3) {
             rankItem->setForeground(QColor(205, 127, 50)); // 铜色
             rankItem->setFont(QFont("Arial", 10, QFont::Bold));
         }
@@ -20,13 +20,20 @@ private slots:
     void on_btnRefresh_clicked();
     void on_btnBack_clicked();
     void onTimeRankingsFinished(const NetworkResponse &response, const QList<TimeRankingInfo> &rankings);
+    void onTableScrolled(int value);
 
 private:
     Ui::TimeRankingDialog *ui;
     NetworkClient *network_client;
+    QString next_cursor;    // 下一页游标，为空表示已全部加载
+    bool loading_more;
+    int query_grid_size;    // 当前查询条件，翻页时沿用
+    bool query_used_undo;
 
     void loadRankings();
+    void loadMoreRankings();
     void updateTable(const QList<TimeRankingInfo> &rankings);
+    void appendRows(const QList<TimeRankingInfo> &rankings);
     void clearTable();
     void showStatus(const QString &message, bool isError = false);
     QString formatTime(int seconds) const;